@@ -6,6 +6,8 @@
 #include "type_conversion.hh"
 #include "instr.hh"
 #include "block.hh"
+#include "opt/frame_slots.hh"
+#include "utils/cancellation_token.hh"
 
 #include <memory>
 #include <cstdint>
@@ -29,19 +31,28 @@ namespace hill {
 			main.add(t);
 		}
 
-		void analyze(const std::vector<token> &rpn)
+		void analyze(const std::vector<token> &rpn, const utils::cancellation_token &cancellation = {})
 		{
 			/*for (auto &t: rpn) {
 				std::cout << " - " << t.to_str();
 			}
 			std::cout << std::endl;*/
 			for (auto &t: rpn) {
+				cancellation.throw_if_cancelled();
 				analyze_token(t);
 			}
 
 			//std::cout << main.to_str();
 		}
 
+		/**
+		 * Rewrites the analyzed code for running, instruction indices and stack offsets may change
+		 */
+		void optimize()
+		{
+			opt::assign_frame_slots(main);
+		}
+
 		const block &get_main_block() const
 		{
 			return main;
@@ -5,16 +5,19 @@
 
 #include "exceptions.hh"
 #include "instr.hh"
+#include "type_conversion.hh"
 
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <unordered_map>
 
 namespace hill {
 
 	struct scope { // The names and values
 		std::map<std::string, std::vector<val_ref>> ids;
+		std::unordered_map<std::string, std::unordered_map<type_id, size_t>> funcs; // Index in ids of the first function of a name by argument type
 		frame_def frame;
 
 		std::shared_ptr<scope> parent = nullptr;
@@ -37,25 +40,25 @@ namespace hill {
 			return v && v->size()>0 ? &((*v)[0]) : nullptr;
 		}
 
-		bool are_matching(const type &pattern, const type &actual) const
+		void add_id(const std::string &identifier, const val_ref &val)
 		{
-			if (pattern==actual) return true;
-			else return false;
+			auto &vals = ids[identifier];
+			if (val.type.first()==basic_type::FUNC) funcs[identifier].try_emplace(val.type.desc().func_arg, vals.size());
+			vals.push_back(val);
 		}
 
-		const val_ref *find_matching_val_ref(const std::string &identifier, const type &pattern) const
+		/**
+		 * The function of the name taking arg_type, from the innermost scope that has one
+		 */
+		const val_ref *find_func(const std::string &identifier, const type &arg_type) const
 		{
-			const val_ref *r = nullptr;
-
-			if (ids.contains(identifier)) {
-				for (const auto &val_ref: ids.at(identifier)) {
-					if (pattern.matches(val_ref.type)) {
-						return &val_ref;
-					}
-				}
+			auto it = funcs.find(identifier);
+			if (it!=funcs.end()) {
+				auto fit = it->second.find(arg_type.id);
+				if (fit!=it->second.end()) return &ids.at(identifier)[fit->second];
 			}
 
-			return r ? r : (parent ? parent->find_matching_val_ref(identifier, pattern) : nullptr);
+			return parent ? parent->find_func(identifier, arg_type) : nullptr;
 		}
 
 		static std::shared_ptr<scope> create()
@@ -118,17 +121,54 @@ namespace hill {
 		}
 	}
 
+	inline instr &instr_at(std::vector<instr> &instrs, size_t iref)
+	{
+		if (iref>=instrs.size()) throw internal_exception();
+		return instrs[iref];
+	}
+
+	/**
+	 * Converts the two numbers on top of the stack to the type an arithmetic operation on them gives.
+	 * The left one is converted from under the right one, which is moved out of the way and back.
+	 * Operands without a common number type, like arrays or tuples, are an error.
+	 */
+	inline void convert_arith_operands(type_stack &ts, std::vector<instr> &instrs)
+	{
+		auto res_type = arith_type(ts.top(1), ts.top());
+		if (res_type.types().empty()) throw semantic_error_exception(error_code::ARITH_TYPE_MISMATCH);
+
+		auto convert = [&](size_t pos, size_t above) {
+			auto &ots = ts.vtop(pos);
+			if (ots==res_type) return;
+
+			instrs.push_back(instr{
+				.op = op_code::CONVERT,
+				.res_type = res_type,
+				.val = {.ix = above},
+				.arg1_type = ots,
+				.arg2_type = type()});
+			ots.id = res_type.id;
+			ots.iref = instrs.size()-1;
+		};
+
+		convert(1, ts.top().mem_size());
+		convert(0, 0);
+	}
+
 	inline bool resolve_rs_id_vals(type_stack &ts, std::vector<instr> &instrs, const scope &s)
 	{
 		auto &rsts = ts.vtop();
-		if (rsts.types.empty()) {
-			auto &rsinstr = instrs[rsts.iref];
+		if (rsts.types().empty()) {
+			auto &rsinstr = instr_at(instrs, rsts.iref);
 			const val_ref *val = s.find_val_ref(rsinstr.id);
 			if (!val) return false;
 
 			rsinstr = make_val_instr(*val, rsinstr.offset);
 
+			// The value now comes from the replaced instruction, not from where it was bound
+			auto iref = rsts.iref;
 			rsts = val->type;
+			rsts.iref = iref;
 		}
 
 		return true;
@@ -137,14 +177,16 @@ namespace hill {
 	inline bool resolve_ls_id_vals(type_stack &ts, std::vector<instr> &instrs, const scope &s)
 	{
 		auto &lsts = ts.vtop(1);
-		if (lsts.types.empty()) {
-			auto &lsinstr = instrs[lsts.iref];
+		if (lsts.types().empty()) {
+			auto &lsinstr = instr_at(instrs, lsts.iref);
 			const val_ref *val = s.find_val_ref(lsinstr.id);
 			if (!val) return false;
 
 			lsinstr = make_val_instr(*val, lsinstr.offset);
 
+			auto iref = lsts.iref;
 			lsts = val->type;
+			lsts.iref = iref;
 		}
 
 		return true;
@@ -155,22 +197,19 @@ namespace hill {
 		if (!resolve_rs_id_vals(ts, instrs, s)) return false;
 
 		auto &lsts = ts.vtop(1);
-		if (lsts.types.empty()) {
+		if (lsts.types().empty()) {
 			// TODO: Make ts: FUNC wildcard RS
-			auto &lsinstr = instrs[lsts.iref];
-
-			type type(basic_type::FUNC);
-			type.types.push_back(basic_type::UNDECIDED);
-			type.types.insert(type.types.end(), ts.top().types.cbegin(), ts.top().types.cend());
-			type.types.push_back(basic_type::END);
+			auto &lsinstr = instr_at(instrs, lsts.iref);
 
-			const val_ref *val = s.find_matching_val_ref(lsinstr.id, type);
+			const val_ref *val = s.find_func(lsinstr.id, ts.top());
 			if (!val) return false;
 
 			lsinstr = make_val_instr(*val, lsinstr.offset);
 
 			//auto &lsts = ts.vtop();
+			auto iref = lsts.iref;
 			lsts = val->type;
+			lsts.iref = iref;
 		}
 
 		return true;
@@ -181,16 +220,17 @@ namespace hill {
 		if (!resolve_rs_id_vals(ts, instrs, s)) return false;
 
 		auto &lsts = ts.vtop(1);
-		if (lsts.types.empty()) {
-			auto lsinstr = instrs[lsts.iref];
+		if (lsts.types().empty()) {
+			auto &lsinstr = instr_at(instrs, lsts.iref);
 
 			const val_ref *val = s.find_val_ref(lsinstr.id);
 			if (!val) return false;
 
 			lsinstr = make_val_instr(*val, lsinstr.offset);
 
-			auto &rsts = ts.vtop();
-			rsts = val->type;
+			auto iref = lsts.iref;
+			lsts = val->type;
+			lsts.iref = iref;
 		}
 
 		return true;
@@ -240,28 +280,35 @@ namespace hill {
 				return false; // End of inner block
 			case tt::RSQUARE:
 				{
+					if (!resolve_rs_id_vals(ts, instrs, s)) throw semantic_error_exception(error_code::UNDEFINED_ID);
+
 					auto &ttype = ts.vtop();
-					std::vector<basic_type> itype;
+					type_id elm_id = 0;
 
 					int cnt = 0;
-					if (ttype.types[0]==basic_type::TUPLE) {
-						itype = inner_type(ttype.types, 1);
-						for (size_t ix=1; ttype.types[ix]!=basic_type::END; ix+=itype.size()) {
-							if (itype!=inner_type(ttype.types, ix))
+					if (ttype.first()==basic_type::TUPLE) {
+						const auto &elms = ttype.desc().elms;
+						if (!elms.empty()) elm_id = elms[0].id;
+						for (const auto &elm : elms) {
+							if (elm.id!=elm_id)
 								throw semantic_error_exception(error_code::ARRAY_ELM_TYPE_MISMATCH);
 							++cnt;
 						}
 					} else {
-						itype = ttype.types;
+						elm_id = ttype.id;
 						cnt = 1;
 					}
+					const auto &itype = type::from_id(elm_id).types();
+					if (itype.empty()) throw semantic_error_exception(error_code::ARRAY_ELM_TYPE_MISMATCH);
+
+					type_buffer types;
+					types.push_back(basic_type::ARRAY);
+					types.append(itype);
+					types.push_back((basic_type)cnt);
 
-					ttype.types.clear();
-					ttype.types.push_back(basic_type::ARRAY);
-					ttype.types.insert(ttype.types.end(), itype.begin(), itype.end() );
-					ttype.types.push_back((basic_type)cnt);
+					types.push_back(basic_type::END);
 
-					ttype.types.push_back(basic_type::END);
+					ttype.id = type(types.span()).id;
 				}
 				break;
 			case tt::END:
@@ -291,56 +338,17 @@ namespace hill {
 				break;
 			case tt::NUM:
 				{
-					char *endp = nullptr;
-#define USE_LOAD_IMMEDIATE
-					if (t.str().find('.')!=std::string::npos) { // floating point (just  double for now)
-						type res_type = type(basic_type::F64);
-#ifdef USE_LOAD_IMMEDIATE
-						instrs.push_back(instr{
-							.op = op_code::LOADI,
-							.res_type = res_type,
-							.val = {.imm_f64 = static_cast<double>(std::strtold(t.get_text().c_str(), &endp))},
-							.arg1_type = type(),
-							.arg2_type = type()});
-#else
-						auto vix = values.add(std::strtold(t.get_text().c_str(), &endp));
-						instrs.push_back(instr{
-							.op = op_code::LOAD,
-							.res_type = res_type,
-							.val = {.ix = vix}});
-#endif /* USE_LOAD_IMMEDIATE */
-						res_type.iref = instrs.size()-1;
-						ts.push(res_type);
-					} else { // integral
-						type res_type = type(basic_type::I32);
-#ifdef USE_LOAD_IMMEDIATE
-						instrs.push_back(instr{
-							.op = op_code::LOADI,
-							.res_type = res_type,
-							.val = {.imm_i32 = static_cast<int32_t>(std::strtol(t.get_text().c_str(), &endp, 10))},
-							.arg1_type = type(),
-							.arg2_type = type()});
-#else
-						auto vix = values.add(std::strtoll(t.get_text().c_str(), &endp, 10));
-						instrs.push_back(instr{
-							.op = op_code::LOAD,
-							.res_type = res_type,
-							.val = {.ix = vix}});
-#endif /* USE_LOAD_IMMEDIATE */
-						res_type.iref = instrs.size()-1;
-						ts.push(res_type);
-					}
+					instrs.push_back(make_num_instr(t.get_text(), 0));
+					auto res_type = instrs.back().res_type;
+					res_type.iref = instrs.size()-1;
+					ts.push(res_type);
 				}
 				break;
 			case tt::OP_PLUS:
 				{
-					/*const auto res_type = convert_binary(
-						t.get_type(),
-						second_last().res_dt,
-						last().res_dt);*/
-
 					if (!resolve_var_id_vals(ts, instrs, s))
 						throw semantic_error_exception(error_code::UNDEFINED_ID);
+					convert_arith_operands(ts, instrs);
 
 					type res_type = ts.top();
 					instrs.push_back(instr{
@@ -357,11 +365,6 @@ namespace hill {
 				break;
 			case tt::OP_MINUS:
 				{
-					/*const auto res_type = convert_binary(
-						t.get_type(),
-						second_last().res_dt,
-						last().res_dt);*/
-
 					if (t.get_arity()==tt_arity::LUNARY) {
 						if (!resolve_rs_id_vals(ts, instrs, s))
 							throw semantic_error_exception(error_code::UNDEFINED_ID);
@@ -379,6 +382,7 @@ namespace hill {
 					} else if (t.get_arity()==tt_arity::BINARY) {
 						if (!resolve_var_id_vals(ts, instrs, s))
 							throw semantic_error_exception(error_code::UNDEFINED_ID);
+						convert_arith_operands(ts, instrs);
 
 						type res_type = ts.top();
 						instrs.push_back(instr{
@@ -400,6 +404,7 @@ namespace hill {
 				{
 					if (!resolve_var_id_vals(ts, instrs, s))
 						throw semantic_error_exception(error_code::UNDEFINED_ID);
+					convert_arith_operands(ts, instrs);
 
 					type res_type = ts.top();
 					instrs.push_back(instr{
@@ -420,11 +425,6 @@ namespace hill {
 					// If it does, that is a compilation error
 					// Maybe try to create some nice error message?
 
-					/*const auto res_type = convert_binary(
-						t.get_type(),
-						second_last().res_dt,
-						last().res_dt);*/
-
 					if (!resolve_rs_id_vals(ts, instrs, s))
 						throw semantic_error_exception(error_code::UNDEFINED_ID);
 
@@ -434,12 +434,13 @@ namespace hill {
 					// Bind id instruction on left side to the value
 					auto val = val_ref(
 						mem_type::STACK,
-						s.frame.add(res_type.mem_size(), 1),
+						s.frame.add(res_type.mem_size(), res_type.mem_align(), 1),
 						res_type);
+					val.type.iref = SIZE_MAX; // Uses of the name refer to their own load, not to this value
 
 					if (instrs.size()<2 || instrs[instrs.size()-2].op!=op_code::ID)
 						throw semantic_error_exception(error_code::UNDEFINED_ID);
-					s.ids[instrs[instrs.size()-2].id].push_back(val);
+					s.add_id(instrs[instrs.size()-2].id, val);
 
 					// TODO: Optimization: Do not copy if immutable variable and right side is immutable
 
@@ -451,6 +452,7 @@ namespace hill {
 						.arg1_type = type(),
 						.arg2_type = ts.top()});
 					ts.pop();
+					ts.pop(); // The name is bound, only the value is left
 					res_type.iref = instrs.size()-1;
 					ts.push(res_type);
 				}
@@ -484,11 +486,6 @@ namespace hill {
 #endif
 			case tt::OP_COMMA:
 				{
-					/*const auto res_type = convert_binary(
-						t.get_type(),
-						second_last().res_dt,
-						last().res_dt);*/
-
 					if (!resolve_var_id_vals(ts, instrs, s)) 
 						throw semantic_error_exception(error_code::UNDEFINED_ID);
 
@@ -498,8 +495,8 @@ namespace hill {
 						.op = op_code::TUPLE,
 						.res_type = res_type,
 						.val = {},
-						.arg1_type = type(),
-						.arg2_type = type()});
+						.arg1_type = ts.top(1),
+						.arg2_type = ts.top()});
 
 					ts.pop();
 					ts.pop();
@@ -521,15 +518,16 @@ namespace hill {
 						ts.pop();
 						ts.push(build_tuple(l_type, r_type));
 
-						if (!resolve_ls_id_vals(ts, instrs, s)) 
+						// The function is picked by the whole argument, the piped value included
+						if (!resolve_call_id_vals(ts, instrs, s)) 
 							throw semantic_error_exception(error_code::UNDEFINED_ID);
 					}
 
 					type res_type;
 					type arg_type;
 					if (ts.top(1).first()==basic_type::FUNC) {
-						res_type = ts.top(1).inner_type(1);
-						arg_type = ts.top(1).inner_type(1+res_type.types.size());
+						res_type = type::from_id(ts.top(1).desc().func_ret);
+						arg_type = type::from_id(ts.top(1).desc().func_arg);
 						
 						if (arg_type!=ts.top()) 
 							throw semantic_error_exception(error_code::UNDEFINED_ID);
@@ -561,7 +559,7 @@ namespace hill {
 					if (arg1_type.first()!=basic_type::TUPLE)
 						throw semantic_error_exception(error_code::MEMBER_ACCESS_ON_NO_TUPLE);
 
-					auto &rsinstr = instrs[arg2_type.iref];
+					auto &rsinstr = instr_at(instrs, arg2_type.iref);
 					auto id = rsinstr.id;
 
 					auto res_type = get_tuple_elm_type(arg1_type, id);
@@ -593,8 +591,8 @@ namespace hill {
 					auto pfunc_type = ts.top();
 
 					// Add padding to place function first end partial data next
-					instrs[arg1_type.iref].offset = (int)type(basic_type::FUNC).mem_size();
-					instrs[pfunc_type.iref].offset = -((int)arg1_type.mem_size() + (int)type(basic_type::FUNC).mem_size());
+					instr_at(instrs, arg1_type.iref).offset = (int)type(basic_type::FUNC).mem_size();
+					instr_at(instrs, pfunc_type.iref).offset = -((int)arg1_type.mem_size() + (int)type(basic_type::FUNC).mem_size());
 
 					arg1_type.is_pipe_arg = true;
 
@@ -3,7 +3,11 @@
 
 #include "value.hh"
 #include "type.hh"
+#include "type_conversion.hh"
 
+#include <array>
+#include <functional>
+#include <utility>
 #include <vector>
 #include <stdint.h>
 #include <stddef.h>
@@ -33,6 +37,14 @@ namespace hill {
 
 		void push(int offset, size_t size, const uint8_t *data)
 		{
+			// Data already on the stack, like a local, moves when the stack grows
+			if (std::greater_equal<const uint8_t *>()(data, mem.data()) && std::less<const uint8_t *>()(data, mem.data() + mem.size())) {
+				auto ix = (size_t)(data - mem.data());
+				uint8_t *p = push_alloc(offset, size);
+				memmove(p, mem.data() + ix, size);
+				return;
+			}
+
 			uint8_t *p = push_alloc(offset, size);
 			memcpy(p, data, size);
 		}
@@ -40,7 +52,7 @@ namespace hill {
 		template<typename T> void push(int offset, T val)
 		{
 			uint8_t *p = push_alloc(offset, sizeof val);
-			*(T *)p = val;
+			store_value(p, val);
 		}
 
 		const uint8_t *top(size_t size) const
@@ -60,17 +72,51 @@ namespace hill {
 
 		template<typename T> T pop()
 		{
-			T ret = *(T *)top(sizeof(T));
+			T ret = load_value<T>(top(sizeof(T)));
 			pop(sizeof(T));
 			return ret;
 		}
 	};
 
+	typedef void (*convert_func)(uint8_t *dst, const uint8_t *src);
+
+	template<typename FROM, typename TO> void convert_value(uint8_t *dst, const uint8_t *src)
+	{
+		store_value(dst, static_cast<TO>(load_value<FROM>(src)));
+	}
+
+	constexpr std::array num_basic_types = {
+		basic_type::I, basic_type::I8, basic_type::I16, basic_type::I32, basic_type::I64,
+		basic_type::U, basic_type::U8, basic_type::U16, basic_type::U32, basic_type::U64,
+		basic_type::F, basic_type::F32, basic_type::F64,
+	};
+
+	typedef std::array<std::array<convert_func, NUM_BASIC_TYPES>, NUM_BASIC_TYPES> convert_funcs_t;
+
+	template<size_t FROM, size_t... TO> constexpr void add_convert_funcs(convert_funcs_t &funcs, std::index_sequence<TO...>)
+	{
+		constexpr auto from = num_basic_types[FROM];
+		((funcs[(size_t)from][(size_t)num_basic_types[TO]] = &convert_value<num_value_t<from>, num_value_t<num_basic_types[TO]>>), ...);
+	}
+
+	template<size_t... FROM> constexpr convert_funcs_t make_convert_funcs(std::index_sequence<FROM...>)
+	{
+		convert_funcs_t funcs{};
+		(add_convert_funcs<FROM>(funcs, std::make_index_sequence<num_basic_types.size()>()), ...);
+		return funcs;
+	}
+
+	/**
+	 * Conversion kernel of every pair of number types, null where either is not a number
+	 */
+	constexpr convert_funcs_t convert_funcs = make_convert_funcs(std::make_index_sequence<num_basic_types.size()>());
+
 	struct evaluator {
 		evaluator() = default;
 
 		stack s;
 		instr result_ins;
+		std::vector<uint8_t> convert_buf; // Reused by every conversion
 
 		value evaluate(const block &b)
 		{
@@ -87,6 +133,7 @@ namespace hill {
 				case op_code::SUB: sub(ins); break;
 				case op_code::MUL: mul(ins); break;
 				case op_code::NEG: neg(ins); break;
+				case op_code::CONVERT: convert(ins); break;
 				case op_code::TUPLE: tuple(ins); break;
 				case op_code::CALL: call(ins); break;
 				case op_code::ID: break; // throw internal_exception();
@@ -106,13 +153,14 @@ namespace hill {
 		void load(const instr &ins)
 		{
 			// TODO: What if we want to load from a different stack frame?
-			s.push(ins.offset, ins.arg2_type.mem_size(), s.data() + ins.val.ix);
+			s.push(ins.offset, ins.res_type.mem_size(), s.data() + ins.val.ix);
 		}
 
 		void loadl(const instr &ins, const literal_values &values)
 		{
-			uint8_t *p = s.push_alloc(ins.offset, ins.res_type.mem_size());
-			values.copy(ins.val.ix, p, ins.res_type.mem_size());
+			auto size = ins.res_type.mem_size();
+			uint8_t *p = s.push_alloc(ins.offset, size);
+			values.copy(ins.val.ix, p, size);
 		}
 
 		/**
@@ -122,21 +170,21 @@ namespace hill {
 		{
 			uint8_t *p = s.push_alloc(ins.offset, ins.res_type.mem_size());
 			
-			switch (ins.res_type.types[0]) {
-			case basic_type::I8: *(int8_t *)p = ins.val.imm_i8; break;
-			case basic_type::I16: *(int16_t *)p = ins.val.imm_i16; break;
-			case basic_type::I32: *(int32_t *)p = ins.val.imm_i32; break;
+			switch (ins.res_type.first()) {
+			case basic_type::I8: store_value(p, ins.val.imm_i8); break;
+			case basic_type::I16: store_value(p, ins.val.imm_i16); break;
+			case basic_type::I32: store_value(p, ins.val.imm_i32); break;
 			case basic_type::I64:
-			case basic_type::I: *(int64_t *)p = ins.val.imm_i64; break;
-			case basic_type::U8: *(uint8_t *)p = ins.val.imm_u8; break;
-			case basic_type::U16: *(uint16_t *)p = ins.val.imm_u16; break;
-			case basic_type::U32: *(uint32_t *)p = ins.val.imm_u32; break;
+			case basic_type::I: store_value(p, ins.val.imm_i64); break;
+			case basic_type::U8: store_value(p, ins.val.imm_u8); break;
+			case basic_type::U16: store_value(p, ins.val.imm_u16); break;
+			case basic_type::U32: store_value(p, ins.val.imm_u32); break;
 			case basic_type::U64:
-			case basic_type::U: *(uint64_t *)p = ins.val.imm_u64; break;
-			case basic_type::F32: *(float *)p = ins.val.imm_f32; break;
+			case basic_type::U: store_value(p, ins.val.imm_u64); break;
+			case basic_type::F32: store_value(p, ins.val.imm_f32); break;
 			case basic_type::F64:
-			case basic_type::F: *(double *)p = ins.val.imm_f64; break;
-			case basic_type::FUNC: *(void **)p = ins.val.imm_p; break;
+			case basic_type::F: store_value(p, ins.val.imm_f64); break;
+			case basic_type::FUNC: store_value(p, ins.val.imm_p); break;
 			default: break; /* Throw? Look for custom implemetation? */
 			}
 		}
@@ -144,11 +192,12 @@ namespace hill {
 		void copy(const instr &ins)
 		{
 			// TODO: Type conversion?
-			const uint8_t *src = s.top(ins.arg2_type.mem_size());
+			auto size = ins.arg2_type.mem_size();
+			const uint8_t *src = s.top(size);
 			uint8_t *dst = s.data() + ins.val.ix;
-			memcpy(dst, src, ins.arg2_type.mem_size());
-			s.pop(ins.arg2_type.mem_size());
-			s.push(ins.offset, ins.arg2_type.mem_size(), dst);
+			memcpy(dst, src, size);
+			s.pop(size);
+			s.push(ins.offset, size, dst);
 		}
 
 		template<typename T> void add(const instr &ins)
@@ -162,7 +211,7 @@ namespace hill {
 			// TODO: Type conversion?
 			// Maybe type conversion is its own instruction and handled by the analizer?
 
-			switch (ins.res_type.types[0]) {
+			switch (ins.res_type.first()) {
 			case basic_type::I8: add<int8_t>(ins); break;
 			case basic_type::I16: add<int16_t>(ins); break;
 			case basic_type::I32: add<int32_t>(ins); break;
@@ -191,7 +240,7 @@ namespace hill {
 			// TODO: Type conversion?
 			// Maybe type conversion is its own instruction and handled by the analizer?
 
-			switch (ins.res_type.types[0]) {
+			switch (ins.res_type.first()) {
 			case basic_type::I8: sub<int8_t>(ins); break;
 			case basic_type::I16: sub<int16_t>(ins); break;
 			case basic_type::I32: sub<int32_t>(ins); break;
@@ -220,7 +269,7 @@ namespace hill {
 			// TODO: Type conversion?
 			// Maybe type conversion is its own instruction and handled by the analizer?
 
-			switch (ins.res_type.types[0]) {
+			switch (ins.res_type.first()) {
 			case basic_type::I8: mul<int8_t>(ins); break;
 			case basic_type::I16: mul<int16_t>(ins); break;
 			case basic_type::I32: mul<int32_t>(ins); break;
@@ -245,7 +294,7 @@ namespace hill {
 		}
 		void neg(const instr &ins)
 		{
-			switch (ins.res_type.types[0]) {
+			switch (ins.res_type.first()) {
 			case basic_type::I8: neg<int8_t>(ins); break;
 			case basic_type::I16: neg<int16_t>(ins); break;
 			case basic_type::I32: neg<int32_t>(ins); break;
@@ -263,18 +312,44 @@ namespace hill {
 			}
 		}
 
+		/**
+		 * The left value and then the right value are on top of the stack, one after the other.
+		 * The left one is already where the tuple starts, the right one is moved to its aligned offset.
+		 */
 		void tuple(const instr &ins)
 		{
-			(void)ins; // Unused for now
-/*			const uint8_t *right = s.top(ins.arg2_type.size());
-			s.pop(ins.arg2_type.size());
-			const uint8_t *left = s.top(ins.arg1_type.size());
-			s.pop(ins.arg1_type.size());
+			auto left_size = ins.arg1_type.mem_size();
+			auto right_size = ins.arg2_type.mem_size();
+			auto res_size = ins.res_type.mem_size();
+			auto right_offset = ins.res_type.desc().elms.back().mem_offset; // Always the last element
+
+			if (right_offset==left_size && res_size==left_size+right_size) return;
 
-			uint8_t *p = s.push_alloc(ins.res_type.size());*/
+			if (res_size>left_size+right_size) s.push_alloc(0, res_size-left_size-right_size);
+			uint8_t *p = s.vtop(std::max(res_size, left_size+right_size));
 
-			// Make tuple
-			// The top of the stack already looks like a tuple
+			memmove(p + right_offset, p + left_size, right_size);
+			if (right_offset>left_size) memset(p + left_size, 0, right_offset-left_size);
+			if (res_size>right_offset+right_size) memset(p + right_offset + right_size, 0, res_size-right_offset-right_size);
+
+			if (res_size<left_size+right_size) s.pop(left_size+right_size-res_size);
+		}
+
+		void convert(const instr &ins)
+		{
+			auto func = convert_funcs[(size_t)ins.arg1_type.first()][(size_t)ins.res_type.first()];
+			if (!func) throw internal_exception();
+
+			// The value may be under another one, which is set aside until the value is converted
+			auto above = ins.val.ix;
+			auto from_size = ins.arg1_type.mem_size();
+			auto to_size = ins.res_type.mem_size();
+			convert_buf.resize(above + from_size);
+			memcpy(convert_buf.data(), s.top(above + from_size), above + from_size);
+			s.pop(above + from_size);
+
+			func(s.push_alloc(0, to_size), convert_buf.data());
+			s.push(0, above, convert_buf.data() + from_size);
 		}
 
 		typedef void (*ifunc)(uint8_t *, const uint8_t *);
@@ -300,7 +375,7 @@ namespace hill {
 			//std::cout << (p-memp) << '\n';
 
 			//auto func = *(void (**)(uint8_t *, const uint8_t *))p;
-			auto func = *(ifunc *)p;
+			auto func = load_value<ifunc>(p);
 
 			func(p+ins.offset, p+func_size);
 
@@ -13,6 +13,11 @@ namespace hill {
 		ARRAY_ELM_TYPE_MISMATCH,
 		MEMBER_ACCESS_ON_NO_TUPLE,
 		UNKNOWN_MEMBER_NAME,
+		UNEXPECTED_TOKEN,
+		UNBALANCED_GROUP,
+		INVALID_NUMBER_LITERAL,
+		ARITH_TYPE_MISMATCH,
+		DIVISION_BY_ZERO,
 	};
 
 	struct exception: std::exception {
@@ -29,6 +34,22 @@ namespace hill {
 		error_code get_error_code() const override {return (error_code)-1;}
 	};
 
+	struct cancelled_exception: exception {
+		const char *what() const noexcept override {return "Operation cancelled";}
+		error_code get_error_code() const override {return (error_code)-1;}
+	};
+
+	struct syntax_error_exception: exception {
+		syntax_error_exception(error_code code): code(code) {}
+
+		const char *what() const noexcept override {return "Syntax error";}
+		error_code get_error_code() const override {
+			return code;
+		};
+
+		error_code code;
+	};
+
 	struct semantic_error_exception: exception {
 		semantic_error_exception(error_code code): code(code) {}
 
@@ -40,10 +61,39 @@ namespace hill {
 		error_code code;
 	};
 
+	struct runtime_error_exception: exception {
+		runtime_error_exception(error_code code): code(code) {}
+
+		const char *what() const noexcept override {return "Runtime error";}
+		error_code get_error_code() const override {
+			return code;
+		};
+
+		error_code code;
+	};
+
 	inline std::string error_code_to_str(error_code ec)
 	{
 		return std::to_string((int)ec);
 	}
+
+	inline const char *error_code_description(error_code ec)
+	{
+		switch (ec) {
+		case error_code::NO_ERROR: return "No error";
+		case error_code::CALLING_NO_FUNC: return "Calling something that is not a function";
+		case error_code::UNDEFINED_ID: return "Undefined identifier";
+		case error_code::ARRAY_ELM_TYPE_MISMATCH: return "Array elements have different types";
+		case error_code::MEMBER_ACCESS_ON_NO_TUPLE: return "Member access on something that is not a tuple";
+		case error_code::UNKNOWN_MEMBER_NAME: return "Unknown member name";
+		case error_code::UNEXPECTED_TOKEN: return "Unexpected token";
+		case error_code::UNBALANCED_GROUP: return "Unbalanced parenthesis or bracket";
+		case error_code::INVALID_NUMBER_LITERAL: return "Invalid number literal";
+		case error_code::ARITH_TYPE_MISMATCH: return "Operands have no common number type";
+		case error_code::DIVISION_BY_ZERO: return "Division by zero";
+		default: return nullptr;
+		}
+	}
 }
 
 #endif /* HILL__EXCEPTIONS_HH_INCLUDED */
@@ -1,6 +1,7 @@
 #ifndef HILL__FMT__FORMATTER_HH_INCLUDED
 #define HILL__FMT__FORMATTER_HH_INCLUDED
 
+#include "../utils/cancellation_token.hh"
 #include "../utils/console.hh"
 #include "../utils/thread_pool.hh"
 #include "../utils/timer.hh"
@@ -30,11 +31,16 @@ namespace hill::fmt {
 			thread_pool.join();
 		}
 
-		static std::string format(const std::istream &istr)
+		static std::string format(const std::istream &istr, const utils::cancellation_token &cancellation = {})
 		{
 			std::stringstream ss;
 
-			ss << istr.rdbuf();
+			char chunk[4096];
+			std::streamsize n;
+			while ((n = istr.rdbuf()->sgetn(chunk, sizeof chunk)) > 0) {
+				cancellation.throw_if_cancelled();
+				ss.write(chunk, n);
+			}
 
 			return ss.str();
 		}
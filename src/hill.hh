@@ -24,6 +24,7 @@ namespace hill {
 		concept analyzer = requires(AT a, std::vector<token> rpn, const std::shared_ptr<scope> &root) {
 			{a.analyze(rpn)};
 			{a.set_trunk(root)};
+			{a.optimize()};
 			{a.get_main_block()};
 		};
 
@@ -44,22 +45,24 @@ namespace hill {
 
 	inline void pf_abs(uint8_t *rp, const uint8_t *ap)
 	{
-		*((int32_t *)rp) = (int32_t)std::abs(*((int32_t *)ap));
+		store_value(rp, (int32_t)std::abs(load_value<int32_t>(ap)));
 	}
 
 	inline void pf_pow(uint8_t *rp, const uint8_t *ap)
 	{
-		*((int32_t *)rp) = (int32_t)std::pow(*((int32_t *)ap), *(((int32_t *)ap)+1));
+		store_value(rp, (int32_t)std::pow(load_value<int32_t>(ap), load_value<int32_t>(ap + sizeof(int32_t))));
 	}
 
 	inline void pf_dpow(uint8_t *rp, const uint8_t *ap)
 	{
-		*((double *)rp) = (double)std::pow(*((double *)ap), *(((double *)ap)+1));
+		store_value(rp, (double)std::pow(load_value<double>(ap), load_value<double>(ap + sizeof(double))));
 	}
 
 	inline void pf_div(uint8_t *rp, uint8_t *ap)
 	{
-		*((int32_t *)rp) = (int32_t)*((int32_t *)ap) / *(((int32_t *)ap)+1);
+		auto divisor = load_value<int32_t>(ap + sizeof(int32_t));
+		if (divisor==0) throw runtime_error_exception(error_code::DIVISION_BY_ZERO);
+		store_value(rp, (int32_t)(load_value<int32_t>(ap) / divisor));
 	}
 
 	inline void pf_select(uint8_t *rp, uint8_t *ap)
@@ -73,35 +76,36 @@ namespace hill {
 	std::shared_ptr<scope> build_lib(const std::shared_ptr<scope> &parent)
 	{
 		auto s = scope::create(parent);
+		constexpr bool pure = true; // Its calls can be shared, or dropped when their results are not used
 
-		s->ids["the_answer"].push_back(val_ref((int32_t)42, basic_type::I32));
-		s->ids["abs"].push_back(val_ref((void *)pf_abs, type({
+		s->add_id("the_answer", val_ref((int32_t)42, basic_type::I32));
+		s->add_id("abs", val_ref((void *)pf_abs, type({
 			basic_type::FUNC,
 			basic_type::I32,
 			basic_type::I32,
-			basic_type::END})));
-		s->ids["pow"].push_back(val_ref((void *)pf_pow, type({
+			basic_type::END}), pure));
+		s->add_id("pow", val_ref((void *)pf_pow, type({
 			basic_type::FUNC,
 			basic_type::I32,
 			basic_type::TUPLE,
 			basic_type::I32,
 			basic_type::I32,
-			basic_type::END})));
-		s->ids["pow"].push_back(val_ref((void *)pf_dpow, type({
+			basic_type::END}), pure));
+		s->add_id("pow", val_ref((void *)pf_dpow, type({
 			basic_type::FUNC,
 			basic_type::F64,
 			basic_type::TUPLE,
 			basic_type::F64,
 			basic_type::F64,
-			basic_type::END})));
-		s->ids["div"].push_back(val_ref((void *)pf_div, type({
+			basic_type::END}), pure));
+		s->add_id("div", val_ref((void *)pf_div, type({
 			basic_type::FUNC,
 			basic_type::I32,
 			basic_type::TUPLE,
 			basic_type::I32,
 			basic_type::I32,
-			basic_type::END})));
-		s->ids["select"].push_back(val_ref((void *)pf_select, type({
+			basic_type::END}))); // Not pure, dropping an unused call would hide a division by zero
+		s->add_id("select", val_ref((void *)pf_select, type({
 			basic_type::FUNC,
 			basic_type::ARRAY,
 			basic_type::I32,
@@ -132,6 +136,7 @@ namespace hill {
 		auto lib = build_lib(root);
 		analyzer.set_trunk(lib);
 		analyzer.analyze(parser.get_rpn());
+		analyzer.optimize();
 
 		return evaluator.evaluate(analyzer.get_main_block());
 	}
@@ -4,7 +4,12 @@
 #include "type.hh"
 #include "val_ref.hh"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <stdint.h>
 
 namespace hill {
@@ -20,6 +25,7 @@ namespace hill {
 		SUB, // Arithmetic subtraction
 		MUL, // Arithmetic multiplication
 		NEG, // Arithmetic negation
+		CONVERT, // Convert a number to another number type
 
 		TUPLE, // Build tuple
 		CALL, // Regular function call
@@ -41,6 +47,7 @@ namespace hill {
 		case op_code::SUB: return "SUB";
 		case op_code::MUL: return "MUL";
 		case op_code::NEG: return "NEG";
+		case op_code::CONVERT: return "CONVERT";
 		case op_code::TUPLE: return "TUPLE";
 		case op_code::CALL: return "CALL";
 		case op_code::TUPLE_ELM: return "TUPLE_ELM";
@@ -94,12 +101,12 @@ namespace hill {
 			case op_code::LOADI:
 				ss << " imm:";
 				switch (this->res_type.first()) {
-				case basic_type::I8: ss << this->val.imm_i8; break;
+				case basic_type::I8: ss << (int)this->val.imm_i8; break;
 				case basic_type::I16: ss << this->val.imm_i16; break;
 				case basic_type::I32: ss << this->val.imm_i32; break;
 				case basic_type::I64:
 				case basic_type::I: ss << this->val.imm_i64; break;
-				case basic_type::U8: ss << this->val.imm_u8; break;
+				case basic_type::U8: ss << (unsigned)this->val.imm_u8; break;
 				case basic_type::U16: ss << this->val.imm_u16; break;
 				case basic_type::U32: ss << this->val.imm_u32; break;
 				case basic_type::U64:
@@ -114,12 +121,23 @@ namespace hill {
 				ss << " ix:" << this->val.ix;
 				ss << " arg2_type:" << this->arg2_type.to_str();
 				break;
+			case op_code::CONVERT:
+				ss << " ix:" << this->val.ix;
+				ss << " arg1_type:" << this->arg1_type.to_str();
+				break;
 			case op_code::ADD:
 			case op_code::SUB:
 			case op_code::MUL:
+			case op_code::CALL:
 				ss << " arg1_type:" << this->arg1_type.to_str();
 				ss << " arg2_type:" << this->arg2_type.to_str();
 				break;
+			case op_code::NEG:
+				ss << " arg1_type:" << this->arg1_type.to_str();
+				break;
+			case op_code::ID:
+				ss << " id:" << this->id;
+				break;
 			default:
 				throw internal_exception();
 			}
@@ -152,6 +170,103 @@ namespace hill {
 		return i;
 	}
 
+	/**
+	 * Type a number literal suffix asks for, the type names without @ and the C suffixes f, l, u and ul.
+	 * Without a suffix an integer is @i32, or @i64 if it does not fit, and a number with a '.' is @f64.
+	 */
+	inline basic_type num_suffix_type(std::string_view suffix, bool is_float)
+	{
+		std::string lower(suffix);
+		std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char ch) {return (char)std::tolower(ch);});
+
+		static const struct {
+			const char *suffix;
+			basic_type bt;
+		} suffixes[] = {
+			{"i8", basic_type::I8}, {"i16", basic_type::I16}, {"i32", basic_type::I32}, {"i64", basic_type::I64},
+			{"u8", basic_type::U8}, {"u16", basic_type::U16}, {"u32", basic_type::U32}, {"u64", basic_type::U64},
+			{"f32", basic_type::F32}, {"f64", basic_type::F64},
+			{"f", basic_type::F32}, {"l", basic_type::I64}, {"u", basic_type::U32}, {"ul", basic_type::U64}, {"lu", basic_type::U64},
+		};
+
+		if (lower.empty()) return is_float ? basic_type::F64 : basic_type::I32;
+		for (const auto &s : suffixes) {
+			if (lower==s.suffix) {
+				// A fraction cannot become an integer
+				if (is_float && s.bt!=basic_type::F32 && s.bt!=basic_type::F64) break;
+				return s.bt;
+			}
+		}
+		throw syntax_error_exception(error_code::INVALID_NUMBER_LITERAL);
+	}
+
+	/**
+	 * Load of a number literal like 100'000, 2.5f or 255u8, the separators left out and the type taken from the suffix.
+	 * The parser keeps the sign of a suffixed one like -128i8, an unsigned one wraps around the way negating it would.
+	 */
+	inline instr make_num_instr(std::string_view text, int offset)
+	{
+		auto negative = !text.empty() && text[0]=='-';
+		if (negative) text.remove_prefix(1);
+
+		auto suffix_ix = text.find_first_not_of("0123456789.'");
+		if (suffix_ix==std::string_view::npos) suffix_ix = text.size();
+
+		std::string digits;
+		for (auto ch : text.substr(0, suffix_ix)) {
+			if (ch!='\'') digits.push_back(ch);
+		}
+		auto is_float = digits.find('.')!=std::string::npos;
+		auto bt = num_suffix_type(text.substr(suffix_ix), is_float);
+
+		auto parse = [&](auto &v) {
+			auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), v);
+			if (digits.empty() || ec!=std::errc() || end!=digits.data() + digits.size()) throw syntax_error_exception(error_code::INVALID_NUMBER_LITERAL);
+		};
+
+		instr i;
+		i.op = op_code::LOADI;
+		i.offset = offset;
+
+		if (bt==basic_type::F32 || bt==basic_type::F64) {
+			if (bt==basic_type::F32) {
+				parse(i.val.imm_f32);
+				if (negative) i.val.imm_f32 = -i.val.imm_f32;
+			} else {
+				parse(i.val.imm_f64);
+				if (negative) i.val.imm_f64 = -i.val.imm_f64;
+			}
+		} else {
+			uint64_t v = 0;
+			parse(v);
+
+			// An integer without a suffix too big for @i32 is @i64, one with a suffix has to fit it
+			if (bt==basic_type::I32 && suffix_ix==text.size() && !std::in_range<int32_t>(v)) bt = basic_type::I64;
+
+			// Signed ones reach one further below zero than above
+			auto mag = v;
+			auto fits_signed = [&](uint64_t max) {return mag<=max + (negative ? 1 : 0);};
+			if (negative) v = 0 - v;
+
+			bool fits = true;
+			switch (bt) {
+			case basic_type::I8: fits = fits_signed(INT8_MAX); i.val.imm_i8 = (int8_t)v; break;
+			case basic_type::I16: fits = fits_signed(INT16_MAX); i.val.imm_i16 = (int16_t)v; break;
+			case basic_type::I32: fits = fits_signed(INT32_MAX); i.val.imm_i32 = (int32_t)v; break;
+			case basic_type::I64: fits = fits_signed(INT64_MAX); i.val.imm_i64 = (int64_t)v; break;
+			case basic_type::U8: fits = std::in_range<uint8_t>(mag); i.val.imm_u8 = (uint8_t)v; break;
+			case basic_type::U16: fits = std::in_range<uint16_t>(mag); i.val.imm_u16 = (uint16_t)v; break;
+			case basic_type::U32: fits = std::in_range<uint32_t>(mag); i.val.imm_u32 = (uint32_t)v; break;
+			case basic_type::U64: i.val.imm_u64 = v; break;
+			default: throw internal_exception();
+			}
+			if (!fits) throw syntax_error_exception(error_code::INVALID_NUMBER_LITERAL);
+		}
+
+		i.res_type = type(bt);
+		return i;
+	}
+
 	inline instr make_placeholder_instr(const std::string &id, int offset)
 	{
 		instr i;
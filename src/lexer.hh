@@ -4,6 +4,7 @@
 #include "token.hh"
 #include "lang_spec.hh"
 #include "exceptions.hh"
+#include "utils/cancellation_token.hh"
 
 #include <algorithm>
 #include <istream>
@@ -15,10 +16,13 @@ namespace hill {
 
 	struct lexer {
 		lexer() = default;
+		explicit lexer(const utils::cancellation_token &cancellation): cancellation(cancellation) {}
 
 		int lix = 0, cix = 0;
 		int plix = -1, pcix = -1;
 
+		utils::cancellation_token cancellation;
+
 		char get(std::istream &istr)
 		{
 			if (istr.eof()) {
@@ -60,6 +64,8 @@ namespace hill {
 
 			int slix = lix, scix = cix;
 
+			cancellation.throw_if_cancelled();
+
 			if (istr.eof()) return token(tt::END, "", slix, scix);
 
 			std::ostringstream text;
@@ -140,10 +146,12 @@ namespace hill {
 					get(istr);
 					ch = peek(istr);
 				}
-				while (std::isalpha(ch)) { // Type specifiers
-					text.put(ch);
-					get(istr);
-					ch = peek(istr);
+				if (std::isalpha(ch)) { // Type specifiers, like f or u16
+					while (std::isalnum(ch)) {
+						text.put(ch);
+						get(istr);
+						ch = peek(istr);
+					}
 				}
 				//unget(istr);
 
@@ -51,6 +51,30 @@ namespace hill::llvm {
 		default: return "unknown";
 		}
 	}
+
+	/**
+	 * Name of the type in LLVM IR, where integers carry no sign
+	 */
+	inline std::string builtin_type_ir_str(builtin_type t)
+	{
+		switch (t) {
+		case builtin_type::VOID: return "void";
+		case builtin_type::I1: return "i1";
+		case builtin_type::I8:
+		case builtin_type::U8: return "i8";
+		case builtin_type::I16:
+		case builtin_type::U16: return "i16";
+		case builtin_type::I32:
+		case builtin_type::U32: return "i32";
+		case builtin_type::I64:
+		case builtin_type::U64: return "i64";
+		case builtin_type::F16: return "half";
+		case builtin_type::F32: return "float";
+		case builtin_type::F64: return "double";
+		case builtin_type::F128: return "fp128";
+		default: return "unknown";
+		}
+	}
 }
 
 #endif /* HILL__LLVM__BUILTIN_TYPE_HH_INCLUDED */
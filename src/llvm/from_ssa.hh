@@ -0,0 +1,153 @@
+#ifndef HILL__LLVM__FROM_SSA_HH_INCLUDED
+#define HILL__LLVM__FROM_SSA_HH_INCLUDED
+
+#include "builtin_type.hh"
+#include "translation_unit.hh"
+#include "../exceptions.hh"
+#include "../ssa.hh"
+#include "../type_conversion.hh"
+#include "../value.hh"
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace hill::llvm {
+
+	inline builtin_type to_builtin_type(basic_type bt)
+	{
+		switch (bt) {
+		case basic_type::I8: return builtin_type::I8;
+		case basic_type::I16: return builtin_type::I16;
+		case basic_type::I32: return builtin_type::I32;
+		case basic_type::I64:
+		case basic_type::I: return builtin_type::I64;
+		case basic_type::U8: return builtin_type::U8;
+		case basic_type::U16: return builtin_type::U16;
+		case basic_type::U32: return builtin_type::U32;
+		case basic_type::U64:
+		case basic_type::U: return builtin_type::U64;
+		case basic_type::F32: return builtin_type::F32;
+		case basic_type::F64:
+		case basic_type::F: return builtin_type::F64;
+		default: throw not_implemented_exception(); // Only numbers for now
+		}
+	}
+
+	/**
+	 * A number constant the way LLVM IR reads it, integers as signed and floats as the bits of a double
+	 */
+	inline std::string constant_str(basic_type bt, const uint8_t *p)
+	{
+		std::ostringstream ss;
+		switch (bt) {
+		case basic_type::I8:
+		case basic_type::U8: ss << (int)load_value<int8_t>(p); break;
+		case basic_type::I16:
+		case basic_type::U16: ss << load_value<int16_t>(p); break;
+		case basic_type::I32:
+		case basic_type::U32: ss << load_value<int32_t>(p); break;
+		case basic_type::I64:
+		case basic_type::I:
+		case basic_type::U64:
+		case basic_type::U: ss << load_value<int64_t>(p); break;
+		case basic_type::F32:
+		case basic_type::F64:
+		case basic_type::F:
+			{
+				double v = bt==basic_type::F32 ? (double)load_value<float>(p) : load_value<double>(p);
+				uint64_t bits;
+				memcpy(&bits, &v, sizeof bits);
+				ss << "0x" << std::hex << std::uppercase << std::setw(16) << std::setfill('0') << bits;
+			}
+			break;
+		default: throw not_implemented_exception();
+		}
+		return ss.str();
+	}
+
+	/**
+	 * Cast instruction from one number type to another, empty if the bits stay the same
+	 */
+	inline std::string cast_str(basic_type from, basic_type to)
+	{
+		auto from_size = basic_type_size(from);
+		auto to_size = basic_type_size(to);
+		if (is_float_type(from) && is_float_type(to)) {
+			return from_size<to_size ? "fpext" : from_size>to_size ? "fptrunc" : "";
+		} else if (is_float_type(from)) {
+			return is_signed_int_type(to) ? "fptosi" : "fptoui";
+		} else if (is_float_type(to)) {
+			return is_signed_int_type(from) ? "sitofp" : "uitofp";
+		} else {
+			return from_size>to_size ? "trunc" : from_size==to_size ? "" : is_signed_int_type(from) ? "sext" : "zext";
+		}
+	}
+
+	/**
+	 * LLVM function computing the value of an SSA function made of numbers only
+	 */
+	inline function translate(const ssa::function &f, const std::string &name)
+	{
+		if (f.blocks.size()!=1) throw not_implemented_exception();
+
+		std::vector<std::string> operands(f.regs.size()); // A register's name, or its value for a constant
+		auto operand = [&](ssa::reg r) {
+			if (operands[r].empty()) throw internal_exception();
+			return operands[r];
+		};
+		auto type_str = [&](ssa::reg r) {
+			return builtin_type_ir_str(to_builtin_type(f.regs[r].first()));
+		};
+
+		function res{.name = name, .return_type = to_builtin_type(f.regs[f.result].first()), .body = {}};
+
+		for (const auto &in : f.blocks[0].instrs) {
+			auto bt = f.regs[in.res].first();
+			auto is_float = is_float_type(bt);
+			auto res_name = "%r" + std::to_string(in.res);
+			auto ty = type_str(in.res);
+
+			switch (in.op) {
+			case ssa::op_code::CONST:
+				operands[in.res] = constant_str(bt, f.consts.data() + in.const_ix);
+				continue;
+			case ssa::op_code::MOV:
+				if (f.regs[in.res]!=f.regs[in.args[0]]) throw not_implemented_exception();
+				operands[in.res] = operand(in.args[0]);
+				continue;
+			case ssa::op_code::ADD:
+			case ssa::op_code::SUB:
+			case ssa::op_code::MUL:
+				{
+					const char *op = in.op==ssa::op_code::ADD ? "add" : in.op==ssa::op_code::SUB ? "sub" : "mul";
+					res.body.push_back(res_name + " = " + (is_float ? "f" : "") + op + " " + ty + " " + operand(in.args[0]) + ", " + operand(in.args[1]));
+				}
+				break;
+			case ssa::op_code::NEG:
+				res.body.push_back(res_name + " = " + (is_float ? "fneg " + ty + " " : "sub " + ty + " 0, ") + operand(in.args[0]));
+				break;
+			case ssa::op_code::CONVERT:
+				{
+					auto from = f.regs[in.args[0]].first();
+					auto cast = cast_str(from, bt);
+					if (cast.empty()) {
+						operands[in.res] = operand(in.args[0]);
+						continue;
+					}
+					res.body.push_back(res_name + " = " + cast + " " + type_str(in.args[0]) + " " + operand(in.args[0]) + " to " + ty);
+				}
+				break;
+			default:
+				throw not_implemented_exception(); // Tuples, arrays and calls
+			}
+			operands[in.res] = res_name;
+		}
+
+		res.body.push_back("ret " + type_str(f.result) + " " + operand(f.result));
+		return res;
+	}
+}
+
+#endif /* HILL__LLVM__FROM_SSA_HH_INCLUDED */
@@ -7,36 +7,26 @@
 
 #include <string>
 #include <fstream>
+#include <ostream>
 #include <memory>
 
 namespace hill::llvm {
 
 	inline void marshal_ir(
 		const std::shared_ptr<translation_unit> &tu,
-		std::ofstream &ofs)
+		std::ostream &ofs)
 	{
 		ofs << "; ModuleID = '" << tu->source_filename << "'\n";
 		ofs << "source_filename = \"" << tu->source_filename << "\"\n";
 		ofs << "target datalayout = \"e-m:w-p270:32:32-p271:32:32-p272:64:64-i64:64-i128:128-f80:128-n8:16:32:64-S128\"\n";
 		ofs << "target triple = \"x86_64-pc-windows-msvc19.44.35215\"\n\n";
 
-		ofs << "; Function Attrs: noinline nounwind optnone uwtable\n"
-			"define dso_local i32 @main() #0 {\n"
-			"  %1 = alloca i32, align 4\n"
-			"  %2 = alloca i32, align 4\n"
-			"  %3 = alloca i32, align 4\n"
-			"  %4 = alloca i32, align 4\n"
-			"  store i32 0, ptr %1, align 4\n"
-			"  store i32 1, ptr %2, align 4\n"
-			"  store i32 2, ptr %3, align 4\n"
-			"  store i32 3, ptr %4, align 4\n"
-			"  %5 = load i32, ptr %2, align 4\n"
-			"  %6 = load i32, ptr %3, align 4\n"
-			"  %7 = mul nsw i32 %5, %6\n"
-			"  %8 = load i32, ptr %4, align 4\n"
-			"  %9 = mul nsw i32 %7, %8\n"
-			"  ret i32 %9\n"
-			"}\n\n";
+		for (const auto &f : tu->functions) {
+			ofs << "; Function Attrs: noinline nounwind optnone uwtable\n";
+			ofs << "define dso_local " << builtin_type_ir_str(f.return_type) << " @" << f.name << "() #0 {\n";
+			for (const auto &line : f.body) ofs << "  " << line << '\n';
+			ofs << "}\n\n";
+		}
 
 		ofs << "attributes #0 = { noinline nounwind optnone uwtable "
 			"\"min-legal-vector-width\"=\"0\" "
@@ -4,6 +4,7 @@
 #include "builtin_type.hh"
 
 #include <string>
+#include <vector>
 
 namespace hill::llvm {
 
@@ -15,8 +16,9 @@ namespace hill::llvm {
 	  ret i32 10
 	}*/
 	struct function {
+		std::string name;
 		builtin_type return_type;
-
+		std::vector<std::string> body; // One instruction per line, without indentation
 	};
 
 	/* Might be called a "module" in llvm land? */
@@ -24,6 +26,8 @@ namespace hill::llvm {
 		/* Header */
 		std::string source_filename;
 
+		std::vector<function> functions;
+
 		/*
 		source_filename = "llvm_example.c"
 		target datalayout = "e-m:w-p270:32:32-p271:32:32-p272:64:64-i64:64-i128:128-f80:128-n8:16:32:64-S128"
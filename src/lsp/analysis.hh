@@ -0,0 +1,295 @@
+#ifndef HILL__LSP__ANALYSIS_HH_INCLUDED
+#define HILL__LSP__ANALYSIS_HH_INCLUDED
+
+#include "document_store.hh"
+#include "parse.hh"
+#include "../analyzer.hh"
+#include "../exceptions.hh"
+#include "../hill.hh"
+#include "../token.hh"
+#include "../val_ref.hh"
+#include "../utils/cancellation_token.hh"
+#include "../utils/string.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hill::lsp {
+
+	/**
+	 * Result of running the parser and analyzer on one document version.
+	 * Top-level statements are analyzed one after the other into the main block, each starting with an empty type stack.
+	 * Analysis stops at the first error, everything added to the scope before it is kept.
+	 *
+	 * A statement is keyed by its tokens, the frame size it starts at and the local bindings of the names it uses,
+	 * which is everything its analysis reads. A statement with the key of one in the previous version
+	 * copies that statement's instructions and bindings instead of being analyzed again.
+	 */
+	struct document_analysis {
+		static constexpr const char *ARTIFACT = "analysis";
+
+		struct statement {
+			uint64_t key;
+			size_t rpn_begin, rpn_end; // Same as the parsed statement
+			size_t instr_begin, instr_end;
+			size_t frame_end;
+			std::vector<std::pair<std::string, val_ref>> bindings; // Added to the locals, in order
+		};
+
+		std::shared_ptr<hill::analyzer> analyzer;
+		std::optional<error_code> error = {};
+		std::string error_message;
+		int error_lix = -1, error_cix = -1; // Where analysis stopped
+
+		// Parsed tokens in analysis order, and the index of the main block instruction each one added
+		std::shared_ptr<const document_parse> parsed;
+		std::vector<size_t> token_instrs;
+
+		std::vector<statement> statements; // Analyzed without error
+		size_t reanalyzed = 0; // Statements analyzed for this version, the others were copied
+
+		const std::vector<token> &rpn() const {return parsed->rpn;}
+
+		const scope &locals() const {return analyzer->get_main_block().s;}
+		const std::vector<instr> &instrs() const {return analyzer->get_main_block().instrs;}
+
+		/**
+		 * Builtins shared by all documents, never modified after creation
+		 */
+		static const std::shared_ptr<scope> &lib()
+		{
+			static const std::shared_ptr<scope> lib = build_lib(build_root());
+			return lib;
+		}
+
+		/**
+		 * Rough size of the instructions and local names, types are interned and not counted
+		 */
+		size_t approx_bytes() const
+		{
+			const auto &block = analyzer->get_main_block();
+			size_t bytes = sizeof *this + sizeof(hill::analyzer)
+				+ token_instrs.capacity()*sizeof(size_t)
+				+ statements.capacity()*sizeof(statement)
+				+ block.instrs.capacity()*sizeof(instr)
+				+ block.values.mem.capacity();
+			for (const auto &[name, vals] : block.s.ids) bytes += name.capacity() + vals.capacity()*sizeof(val_ref);
+			for (const auto &[name, by_arg] : block.s.funcs) bytes += name.capacity() + by_arg.size()*sizeof(std::pair<type_id, size_t>);
+			for (const auto &st : statements) bytes += st.bindings.capacity()*sizeof(std::pair<std::string, val_ref>);
+			return bytes;
+		}
+
+		static std::shared_ptr<const document_analysis> get(const document &doc, const utils::cancellation_token &cancellation = {})
+		{
+			return doc.derived<document_analysis>([&] {return analyze(doc, cancellation);});
+		}
+
+	private:
+		/**
+		 * Distinct names in the tokens, the only ids a statement can look up or bind
+		 */
+		static std::vector<std::string> names_of(const std::vector<token> &rpn, size_t begin, size_t end)
+		{
+			std::vector<std::string> names;
+			for (auto ix=begin; ix<end; ++ix) {
+				if (rpn[ix].get_type()==tt::NAME) names.push_back(rpn[ix].get_text());
+			}
+			std::sort(names.begin(), names.end());
+			names.erase(std::unique(names.begin(), names.end()), names.end());
+			return names;
+		}
+
+		template<typename T> static uint64_t mix(uint64_t hash, const T &val)
+		{
+			return utils::fnv1a_64(std::string_view((const char *)&val, sizeof val), hash);
+		}
+
+		static uint64_t mix(uint64_t hash, std::string_view s)
+		{
+			return utils::fnv1a_64(s, mix(hash, s.size()));
+		}
+
+		/**
+		 * Hash of the local bindings of each name, updated as they are added so a key does not walk them all
+		 */
+		struct binding_hashes {
+			std::unordered_map<std::string, uint64_t> hashes;
+
+			void add(const std::string &name, const val_ref &val)
+			{
+				auto [it, added] = hashes.try_emplace(name, utils::fnv1a_64(""));
+				it->second = mix(mix(mix(it->second, val.mt), val.val), val.type.id);
+			}
+
+			uint64_t get(const std::string &name) const
+			{
+				auto it = hashes.find(name);
+				return it==hashes.end() ? 0 : it->second;
+			}
+		};
+
+		static uint64_t key_of(const std::vector<token> &rpn, size_t begin, size_t end, const std::vector<std::string> &names,
+			size_t frame_ix, const binding_hashes &bindings)
+		{
+			uint64_t hash = mix(utils::fnv1a_64(""), frame_ix);
+			for (auto ix=begin; ix<end; ++ix) {
+				const auto &t = rpn[ix];
+				hash = mix(mix(mix(hash, t.get_type()), t.get_arity()), std::string_view(t.get_text()));
+			}
+			for (const auto &name : names) hash = mix(mix(hash, std::string_view(name)), bindings.get(name));
+			return hash;
+		}
+
+		/**
+		 * Appends a statement of the previous version, its instruction indices moved to the end of the main block
+		 */
+		static void reuse(document_analysis &res, const document_analysis &prev, const statement &st, size_t rpn_begin, binding_hashes &hashes)
+		{
+			auto &main = res.analyzer->main;
+			auto base = main.instrs.size();
+			auto move = [&](size_t &iref) {
+				if (iref!=SIZE_MAX) iref = iref - st.instr_begin + base;
+			};
+
+			for (auto ix=st.instr_begin; ix<st.instr_end; ++ix) {
+				auto in = prev.instrs()[ix];
+				move(in.res_type.iref);
+				move(in.arg1_type.iref);
+				move(in.arg2_type.iref);
+				main.instrs.push_back(std::move(in));
+			}
+			for (auto ix=st.rpn_begin; ix<st.rpn_end; ++ix) {
+				auto iix = prev.token_instrs[ix];
+				move(iix);
+				res.token_instrs.push_back(iix);
+			}
+			for (const auto &[name, val] : st.bindings) {
+				main.s.add_id(name, val);
+				hashes.add(name, val);
+			}
+			main.s.frame.ix = st.frame_end;
+
+			auto copy = st;
+			copy.rpn_begin = rpn_begin;
+			copy.rpn_end = rpn_begin + st.rpn_end - st.rpn_begin;
+			copy.instr_begin = base;
+			copy.instr_end = main.instrs.size();
+			res.statements.push_back(std::move(copy));
+		}
+
+		static std::shared_ptr<const document_analysis> analyze(const document &doc, const utils::cancellation_token &cancellation)
+		{
+			auto res = std::make_shared<document_analysis>();
+			res->analyzer = std::make_shared<hill::analyzer>();
+			res->analyzer->set_trunk(lib());
+
+			res->parsed = document_parse::get(doc, cancellation);
+			const auto &rpn = res->parsed->rpn;
+
+			auto prev = doc.previous<document_analysis>();
+			std::unordered_map<uint64_t, const statement *> prev_statements;
+			if (prev) {
+				for (const auto &st : prev->statements) prev_statements.emplace(st.key, &st);
+				res->analyzer->main.instrs.reserve(prev->instrs().size());
+				res->token_instrs.reserve(prev->token_instrs.size());
+			}
+
+			auto &main = res->analyzer->main;
+			binding_hashes hashes;
+			try {
+				for (const auto &parsed : res->parsed->statements) {
+					cancellation.throw_if_cancelled();
+
+					// The ';' ending a statement and the END after the last one add nothing
+					auto end = parsed.rpn_end;
+					if (end>parsed.rpn_begin && rpn[end-1].get_type()==tt::OP_SEMICOLON) --end;
+					if (end==parsed.rpn_begin+1 && rpn[parsed.rpn_begin].get_type()==tt::END) --end;
+
+					auto names = names_of(rpn, parsed.rpn_begin, end);
+					auto key = key_of(rpn, parsed.rpn_begin, parsed.rpn_end, names, main.s.frame.ix, hashes);
+
+					auto it = prev_statements.find(key);
+					if (it!=prev_statements.end() && it->second->rpn_end-it->second->rpn_begin==parsed.rpn_end-parsed.rpn_begin) {
+						reuse(*res, *prev, *it->second, parsed.rpn_begin, hashes);
+						continue;
+					}
+
+					std::vector<size_t> bound;
+					for (const auto &name : names) {
+						auto found = main.s.ids.find(name);
+						bound.push_back(found==main.s.ids.end() ? 0 : found->second.size());
+					}
+
+					auto instr_begin = main.instrs.size();
+					for (auto ix=parsed.rpn_begin; ix<parsed.rpn_end; ++ix) {
+						cancellation.throw_if_cancelled();
+
+						// Record before analyzing, the token is kept unmapped if it throws
+						res->token_instrs.push_back(SIZE_MAX);
+						if (ix>=end) continue;
+						auto cnt = main.instrs.size();
+						res->analyzer->analyze_token(rpn[ix]);
+						// Conversions of the operands come first, the token's own instruction is the last one
+						if (main.instrs.size()>cnt) res->token_instrs.back() = main.instrs.size()-1;
+					}
+					main.ts = type_stack();
+
+					auto st = statement{
+						.key = key,
+						.rpn_begin = parsed.rpn_begin, .rpn_end = parsed.rpn_end,
+						.instr_begin = instr_begin, .instr_end = main.instrs.size(),
+						.frame_end = main.s.frame.ix,
+						.bindings = {}};
+					for (size_t ix=0; ix<names.size(); ++ix) {
+						auto found = main.s.ids.find(names[ix]);
+						if (found==main.s.ids.end()) continue;
+						for (auto vix=bound[ix]; vix<found->second.size(); ++vix) {
+							st.bindings.emplace_back(names[ix], found->second[vix]);
+							hashes.add(names[ix], found->second[vix]);
+						}
+					}
+					res->statements.push_back(std::move(st));
+					++res->reanalyzed;
+				}
+			} catch (const cancelled_exception &) {
+				throw;
+			} catch (const hill::exception &e) {
+				res->error = e.get_error_code();
+				res->error_message = e.what();
+			} catch (const std::exception &e) {
+				res->error = (error_code)-1;
+				res->error_message = e.what();
+			}
+
+			if (res->error) {
+				// The token analysis stopped at, tokens made up by the parser may have no position
+				const auto &t = res->parsed->rpn[res->token_instrs.size()-1];
+				res->error_lix = t.lix;
+				res->error_cix = t.cix;
+				if (t.lix<0) {
+					auto [lix, cix] = doc.position(doc.text.size());
+					res->error_lix = lix;
+					res->error_cix = cix;
+				}
+			} else if (res->parsed->error) {
+				// Everything parsed before the syntax error was analyzed
+				res->error = res->parsed->error;
+				res->error_message = res->parsed->error_message;
+				res->error_lix = res->parsed->error_lix;
+				res->error_cix = res->parsed->error_cix;
+			}
+
+			return res;
+		}
+	};
+}
+
+#endif /* HILL__LSP__ANALYSIS_HH_INCLUDED */
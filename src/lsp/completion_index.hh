@@ -0,0 +1,171 @@
+#ifndef HILL__LSP__COMPLETION_INDEX_HH_INCLUDED
+#define HILL__LSP__COMPLETION_INDEX_HH_INCLUDED
+
+#include "analysis.hh"
+#include "document_store.hh"
+#include "models.hh"
+#include "../lang_spec.hh"
+#include "../token.hh"
+#include "../type.hh"
+#include "../utils/cancellation_token.hh"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace hill::lsp {
+
+	/**
+	 * Sorted completion candidates for one document version, looked up by prefix
+	 */
+	struct completion_index {
+		enum {MAX_ITEMS = 100};
+		static constexpr const char *ARTIFACT = "completion_index";
+
+		struct entry {
+			std::string label;
+			models::completion_item_kind kind;
+			std::string detail;
+			int lix = -1, cix = -1; // End of the binding name for locals, -1 for builtins
+		};
+
+		struct result {
+			std::vector<const entry *> entries;
+			bool is_incomplete = false;
+		};
+
+		/**
+		 * Entries starting with the prefix that are visible at the position, at most limit of them
+		 */
+		result query(std::string_view prefix, int lix, int cix, size_t limit = MAX_ITEMS) const
+		{
+			result res;
+
+			auto it = std::lower_bound(entries.begin(), entries.end(), prefix,
+				[](const entry &e, std::string_view p) {return std::string_view(e.label) < p;});
+			for (; it!=entries.end() && std::string_view(it->label).starts_with(prefix); ++it) {
+				if (it->lix>=0 && std::tie(it->lix, it->cix) >= std::tie(lix, cix)) continue; // Bound later
+				if (res.entries.size()==limit) {
+					res.is_incomplete = true;
+					break;
+				}
+				res.entries.push_back(&*it);
+			}
+
+			return res;
+		}
+
+		size_t approx_bytes() const
+		{
+			size_t bytes = sizeof *this + entries.capacity()*sizeof(entry);
+			for (const auto &e : entries) bytes += e.label.capacity() + e.detail.capacity();
+			return bytes;
+		}
+
+		static std::shared_ptr<const completion_index> get(const document &doc, const utils::cancellation_token &cancellation = {})
+		{
+			return doc.derived<completion_index>([&] {return build(doc, cancellation);});
+		}
+
+	private:
+		std::vector<entry> entries; // Sorted by label
+
+		static std::string types_str(const std::vector<val_ref> &vals)
+		{
+			std::string str;
+			for (const auto &val : vals) {
+				if (!str.empty()) str += " | ";
+				try {
+					str += val.type.to_str();
+				} catch (const hill::exception &) {}
+			}
+			return str;
+		}
+
+		static std::shared_ptr<const completion_index> build(const document &doc, const utils::cancellation_token &cancellation)
+		{
+			auto index = std::make_shared<completion_index>();
+			auto &entries = index->entries;
+
+			for (const auto &[label, detail] : builtin_types()) {
+				entries.push_back(entry{.label = label, .kind = models::completion_item_kind::KEYWORD, .detail = detail});
+			}
+
+			for (const auto &[name, vals] : document_analysis::lib()->ids) {
+				auto kind = !vals.empty() && vals[0].type.first()==basic_type::FUNC
+					? models::completion_item_kind::FUNCTION
+					: models::completion_item_kind::CONSTANT;
+				entries.push_back(entry{.label = name, .kind = kind, .detail = types_str(vals)});
+			}
+
+			// Local bindings are found in the tokens so they are known even when analysis fails,
+			// the analyzed scope adds the type where it got that far
+			auto analysis = document_analysis::get(doc, cancellation);
+			auto tokens_ptr = doc.tokens(cancellation);
+			const auto &tokens = *tokens_ptr;
+			std::map<std::string, entry> locals;
+
+			for (size_t ix=0; ix+1<tokens.size(); ++ix) {
+				if (tokens[ix].get_type()!=tt::NAME) continue;
+
+				size_t next = ix+1;
+				while (next<tokens.size() && (tokens[next].ws() || tokens[next].get_type()==tt::COMMENT)) ++next;
+				if (next>=tokens.size() || tokens[next].get_type()!=tt::OP_COLON_EQ) continue;
+
+				const auto &name = tokens[ix].get_text();
+				if (locals.contains(name)) continue;
+
+				const auto *vals = analysis->locals().ids.contains(name) ? &analysis->locals().ids.at(name) : nullptr;
+				locals[name] = entry{
+					.label = name,
+					.kind = models::completion_item_kind::VARIABLE,
+					.detail = vals ? types_str(*vals) : "",
+					.lix = tokens[ix+1].lix,
+					.cix = tokens[ix+1].cix};
+			}
+			for (auto &[name, e] : locals) entries.push_back(std::move(e));
+
+			std::stable_sort(entries.begin(), entries.end(), [](const entry &a, const entry &b) {return a.label < b.label;});
+			return index;
+		}
+
+		static const std::vector<std::pair<std::string, std::string>> &builtin_types()
+		{
+			static const std::vector<std::pair<std::string, std::string>> types = {
+				{"@i8", "8-bit signed integer"},
+				{"@i16", "16-bit signed integer"},
+				{"@i32", "32-bit signed integer"},
+				{"@i64", "64-bit signed integer"},
+				{"@i128", "128-bit signed integer"},
+				{"i8", "8-bit integer"},
+				{"i16", "16-bit integer"},
+				{"i32", "32-bit integer"},
+				{"i64", "64-bit integer"},
+				{"i128", "128-bit integer"},
+				{"@u8", "8-bit unsigned integer"},
+				{"@u16", "16-bit unsigned integer"},
+				{"@u32", "32-bit unsigned integer"},
+				{"@u64", "64-bit unsigned integer"},
+				{"@u128", "128-bit unsigned integer"},
+				{"u8", "8-bit unsigned integer"},
+				{"u16", "16-bit unsigned integer"},
+				{"u32", "32-bit unsigned integer"},
+				{"u64", "64-bit unsigned integer"},
+				{"u128", "128-bit unsigned integer"},
+				{"@f32", "32-bit floating point (single)"},
+				{"@f64", "64-bit floating point (double)"},
+				{"f32", "32-bit floating point (single)"},
+				{"f64", "64-bit floating point (double)"},
+				{"mut", "Mutable modifier"},
+				{"@mut", "Mutable modifier"},
+			};
+			return types;
+		}
+	};
+}
+
+#endif /* HILL__LSP__COMPLETION_INDEX_HH_INCLUDED */
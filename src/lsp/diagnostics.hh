@@ -0,0 +1,157 @@
+#ifndef HILL__LSP__DIAGNOSTICS_HH_INCLUDED
+#define HILL__LSP__DIAGNOSTICS_HH_INCLUDED
+
+#include "analysis.hh"
+#include "document_store.hh"
+#include "logger.hh"
+#include "models.hh"
+#include "../exceptions.hh"
+#include "../utils/cancellation_token.hh"
+#include "../utils/string.hh"
+#include "../utils/thread_pool.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hill::lsp {
+
+	/**
+	 * Errors found in one document version, answered by the pull model.
+	 * The result id is derived from the text only, so identical content keeps its id
+	 * across versions, closing and reopening, and restarts of the server.
+	 */
+	struct document_diagnostics {
+		static constexpr const char *ARTIFACT = "diagnostics";
+
+		std::string result_id;
+		std::vector<models::diagnostic> items;
+
+		static std::string result_id_of(uint64_t text_hash)
+		{
+			std::ostringstream ss;
+			ss << std::hex << text_hash;
+			return ss.str();
+		}
+
+		static std::string result_id_of(std::string_view text) {return result_id_of(utils::fnv1a_64(text));}
+
+		size_t approx_bytes() const
+		{
+			size_t bytes = sizeof *this + result_id.capacity() + items.capacity()*sizeof(models::diagnostic);
+			for (const auto &item : items) bytes += item.message.capacity();
+			return bytes;
+		}
+
+		static std::shared_ptr<const document_diagnostics> get(const document &doc, const utils::cancellation_token &cancellation = {})
+		{
+			return doc.derived<document_diagnostics>([&] {return build(doc, cancellation);});
+		}
+
+		/**
+		 * Diagnostics of a document that is not cached, like a closed file read from disk
+		 */
+		static std::shared_ptr<const document_diagnostics> build(const document &doc, const utils::cancellation_token &cancellation)
+		{
+			auto res = std::make_shared<document_diagnostics>();
+			res->result_id = result_id_of(doc.text);
+
+			auto analysis = document_analysis::get(doc, cancellation);
+
+			// Only errors in the program are reported, not what the analyzer does not support yet
+			if (!analysis->error || (int)*analysis->error<=0 || analysis->error_lix<0) return res;
+
+			auto lix = (uint32_t)analysis->error_lix;
+			auto cix = (uint32_t)analysis->error_cix;
+			auto description = error_code_description(*analysis->error);
+
+			res->items.push_back(models::diagnostic{
+				.range = {
+					.start = {.line = lix, .character = cix},
+					.end = {.line = lix, .character = std::max(cix, (uint32_t)doc.line_length(lix))},
+				},
+				.severity = models::diagnostic_severity::ERROR,
+				.code = (int)*analysis->error,
+				.source = "hill",
+				.message = description ? description : analysis->error_message,
+			});
+			return res;
+		}
+	};
+
+	/**
+	 * Runs fn(ix) for every ix below cnt on the calling thread and on idle pool threads.
+	 * The calling thread takes part, so this never waits on a pool that is busy or has a single thread.
+	 * on_progress is called on the calling thread while waiting for the last items.
+	 */
+	inline void parallel_for(utils::thread_pool *pool, size_t cnt, std::function<void(size_t)> fn, const std::function<void()> &on_progress = {})
+	{
+		struct shared_state {
+			std::function<void(size_t)> fn;
+			size_t cnt;
+			std::atomic<size_t> next = 0;
+			std::mutex mutex;
+			std::condition_variable cond;
+			size_t done = 0;
+
+			/**
+			 * Runs one item if any is left, an item that throws still counts as done.
+			 * fn reports its own failures, what gets here is logged. Cancellation is left to the caller's token.
+			 */
+			bool run_next()
+			{
+				auto ix = next.fetch_add(1);
+				if (ix>=cnt) return false;
+
+				try {
+					fn(ix);
+				} catch (const cancelled_exception &) {
+				} catch (const std::exception &e) {
+					logger::error([&] {return "parallel_for item<" + std::to_string(ix) + "> failed: " + e.what();});
+				}
+
+				std::lock_guard<std::mutex> guard(mutex);
+				if (++done==cnt) cond.notify_all();
+				return true;
+			}
+		};
+
+		if (!cnt) return;
+
+		auto state = std::make_shared<shared_state>();
+		state->fn = std::move(fn);
+		state->cnt = cnt;
+
+		// Helpers that start after the work is taken return right away, they only hold the shared state
+		if (pool) {
+			auto helpers = std::min<size_t>(pool->thread_count(), cnt-1);
+			for (size_t ix=0; ix<helpers; ++ix) pool->queue_job([state] {while (state->run_next());});
+		}
+
+		while (state->run_next()) {
+			if (on_progress) on_progress();
+		}
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		while (state->done<cnt) {
+			state->cond.wait_for(lock, std::chrono::milliseconds(50));
+			if (on_progress) {
+				lock.unlock();
+				on_progress();
+				lock.lock();
+			}
+		}
+	}
+}
+
+#endif /* HILL__LSP__DIAGNOSTICS_HH_INCLUDED */
@@ -1,47 +1,500 @@
 #ifndef HILL__LSP__DOCUMENT_STORE_HH_INCLUDED
 #define HILL__LSP__DOCUMENT_STORE_HH_INCLUDED
 
-#include <string>
-#include <unordered_map>
+#include "memory_budget.hh"
+#include "../exceptions.hh"
+#include "../lexer.hh"
+#include "../token.hh"
+#include "../utils/cancellation_token.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
 
 namespace hill::lsp {
 
+	inline size_t approx_bytes(const std::vector<token> &tokens)
+	{
+		size_t bytes = tokens.capacity()*sizeof(token);
+		for (const auto &t : tokens) bytes += t.get_text().capacity();
+		return bytes;
+	}
+
+	/**
+	 * Reads a string without copying it, for lexing from the middle of a text
+	 */
+	struct string_view_buf: std::streambuf {
+		explicit string_view_buf(std::string_view s)
+		{
+			auto begin = const_cast<char *>(s.data());
+			setg(begin, begin, begin+s.size());
+		}
+	};
+
+	/**
+	 * How the tokens of a document relate to those of the version it was edited from.
+	 * Tokens before prefix are the same. From old_suffix on, the tokens of the previous version
+	 * continue at new_suffix, moved by the edit. Without a common tail old_suffix is past the end.
+	 */
+	struct token_diff {
+		size_t prefix;
+		size_t old_suffix, new_suffix;
+		int old_end_lix, old_end_cix; // End of the replaced text in the previous version
+		int new_end_lix, new_end_cix; // End of the inserted text
+
+		/**
+		 * Move a position from after the edit in the previous version to this version
+		 */
+		void move(int &lix, int &cix) const
+		{
+			if (lix<0) return;
+			if (lix==old_end_lix) cix += new_end_cix-old_end_cix;
+			lix += new_end_lix-old_end_lix;
+		}
+	};
+
+	/**
+	 * Immutable snapshot of one version of a document.
+	 * Derived data is computed on first use and shared by every request on the same version.
+	 */
+	struct document {
+		document(const std::string &uri, int version, const std::string &text, memory_budget *budget = nullptr):
+			uri(uri),
+			version(version),
+			text(text),
+			budget(budget)
+		{
+			line_starts.push_back(0);
+			for (size_t ix=0; ix<text.size(); ++ix) {
+				if (text[ix]=='\n') line_starts.push_back(ix+1);
+			}
+		}
+
+		~document()
+		{
+			evict();
+		}
+
+		const std::string uri;
+		const int version;
+		const std::string text;
+
+		size_t line_cnt() const {return line_starts.size();}
+
+		/**
+		 * Length of a line without its line break
+		 */
+		size_t line_length(size_t lix) const
+		{
+			if (lix>=line_starts.size()) return 0;
+			auto begin = line_starts[lix];
+			auto end = lix+1<line_starts.size() ? line_starts[lix+1]-1 : text.size();
+			if (end>begin && text[end-1]=='\r') --end;
+			return end-begin;
+		}
+
+		/**
+		 * Offset in the text of a line and column, clamped to the text
+		 */
+		size_t offset(size_t lix, size_t cix) const
+		{
+			if (lix>=line_starts.size()) return text.size();
+			return std::min(line_starts[lix] + cix, text.size());
+		}
+
+		/**
+		 * Line and column of an offset in the text
+		 */
+		std::pair<int, int> position(size_t offset) const
+		{
+			offset = std::min(offset, text.size());
+			auto it = std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+			auto lix = (size_t)(it-line_starts.begin())-1;
+			return {(int)lix, (int)(offset-line_starts[lix])};
+		}
+
+		/**
+		 * Text of a line without its line break
+		 */
+		std::string_view line(size_t lix) const
+		{
+			if (lix>=line_starts.size()) return {};
+			return std::string_view(text).substr(line_starts[lix], line_length(lix));
+		}
+
+		/**
+		 * All tokens including whitespace, so each token ends where the next one starts.
+		 * The last token is always tt::END. Lexing stops at the first error.
+		 * The tokens stay valid while the pointer is held, even if the cache is evicted.
+		 */
+		std::shared_ptr<const std::vector<token>> tokens(const utils::cancellation_token &cancellation = {}) const
+		{
+			touch();
+			std::lock_guard<std::mutex> guard(cache_mutex);
+			if (!lexed) {
+				lexed = std::make_shared<const std::vector<token>>(lex(cancellation));
+				account("tokens", approx_bytes(*lexed));
+			}
+			return lexed;
+		}
+
+		/**
+		 * Data derived from this version, built on first use and then shared.
+		 * Each type of derived data is cached once per document.
+		 * T names its kind in T::ARTIFACT and estimates its size with approx_bytes().
+		 */
+		template<typename T, typename FN> std::shared_ptr<const T> derived(FN &&build) const
+		{
+			touch();
+			{
+				std::lock_guard<std::mutex> guard(cache_mutex);
+				auto it = derived_cache.find(typeid(T));
+				if (it!=derived_cache.end()) return std::static_pointer_cast<const T>(it->second.data);
+			}
+
+			// Built without holding the lock, it may depend on other derived data
+			std::shared_ptr<const T> data = build();
+
+			std::lock_guard<std::mutex> guard(cache_mutex);
+			auto [it, added] = derived_cache.emplace(typeid(T), cached{.data = data, .artifact = T::ARTIFACT, .bytes = 0});
+			if (added) {
+				it->second.bytes = data->approx_bytes();
+				account(T::ARTIFACT, it->second.bytes);
+			}
+			previous_cache.erase(typeid(T)); // Only needed until this version has its own
+			return std::static_pointer_cast<const T>(it->second.data);
+		}
+
+		/**
+		 * Derived data of the version this one was edited from, if it had been built.
+		 * Used to build this version incrementally, together with the token diff.
+		 */
+		template<typename T> std::shared_ptr<const T> previous() const
+		{
+			std::lock_guard<std::mutex> guard(cache_mutex);
+			auto it = previous_cache.find(typeid(T));
+			return it==previous_cache.end() ? nullptr : std::static_pointer_cast<const T>(it->second);
+		}
+
+		const std::optional<token_diff> &get_token_diff() const {return diff;}
+
+		/**
+		 * The next version, replacing the text between two offsets.
+		 * If the tokens of this version are known, only the edited region is lexed again:
+		 * lexing resumes at the last token boundary before the edit and stops as soon as
+		 * a token starts where one started before, past the edit.
+		 */
+		std::shared_ptr<const document> edit(size_t begin, size_t end, std::string_view replacement, int next_version, memory_budget *next_budget) const
+		{
+			end = std::min(end, text.size());
+			begin = std::min(begin, end);
+
+			std::string next_text;
+			next_text.reserve(text.size()-(end-begin)+replacement.size());
+			next_text.append(text, 0, begin).append(replacement).append(text, end);
+
+			auto next = std::make_shared<document>(uri, next_version, next_text, next_budget);
+
+			std::shared_ptr<const std::vector<token>> tokens;
+			{
+				std::lock_guard<std::mutex> guard(cache_mutex);
+				tokens = lexed;
+				for (const auto &[type, c] : derived_cache) next->previous_cache.emplace(type, c.data);
+			}
+			if (!tokens) return next;
+
+			auto relexed = std::make_shared<std::vector<token>>();
+			next->diff = relex(*tokens, *next, begin, end, begin+replacement.size(), *relexed);
+			if (!next->diff) return next;
+
+			std::lock_guard<std::mutex> guard(next->cache_mutex);
+			next->lexed = std::move(relexed);
+			next->account("tokens", approx_bytes(*next->lexed));
+			return next;
+		}
+
+		/**
+		 * Drop everything derived, it is built again on next use.
+		 * Requests still holding derived data keep it alive until they are done.
+		 */
+		size_t evict() const
+		{
+			std::lock_guard<std::mutex> guard(cache_mutex);
+			size_t freed = 0;
+
+			if (lexed) {
+				auto bytes = approx_bytes(*lexed);
+				if (budget) budget->sub("tokens", bytes);
+				freed += bytes;
+				lexed = nullptr;
+			}
+			for (const auto &[type, c] : derived_cache) {
+				if (budget) budget->sub(c.artifact, c.bytes);
+				freed += c.bytes;
+			}
+			derived_cache.clear();
+			previous_cache.clear();
+
+			cached_bytes = 0;
+			return freed;
+		}
+
+		size_t get_cached_bytes() const {return cached_bytes;}
+		uint64_t get_last_used() const {return last_used;}
+
+	private:
+		std::vector<token> lex(const utils::cancellation_token &cancellation) const
+		{
+			std::vector<token> tokens;
+			std::istringstream istr(text);
+			hill::lexer lexer(cancellation);
+
+			try {
+				while (true) {
+					auto t = lexer.get_token(istr);
+					if (t.end()) break;
+					tokens.push_back(std::move(t));
+				}
+			} catch (const cancelled_exception &) {
+				throw;
+			} catch (const hill::exception &) {}
+
+			tokens.push_back(token(tt::END, "", lexer.lix, lexer.cix));
+			return tokens;
+		}
+
+		/**
+		 * Tokens of the next version from the tokens of this one.
+		 * The lexer keeps no state between tokens and a token depends on at most one character after it,
+		 * so every token boundary is a safe point to resume from and to resynchronize at.
+		 */
+		std::optional<token_diff> relex(const std::vector<token> &old_tokens, const document &next,
+			size_t begin, size_t old_end, size_t new_end, std::vector<token> &tokens) const
+		{
+			auto old_offset = [&](size_t ix) {return offset((size_t)old_tokens[ix].lix, (size_t)old_tokens[ix].cix);};
+
+			// Lexing stopped early at an error or ran past the end, nothing is known about the rest
+			size_t last = old_tokens.size()-1;
+			if (position(text.size())!=std::make_pair(old_tokens[last].lix, old_tokens[last].cix)) return {};
+
+			// First token that may lex differently, it ends at or after the edit
+			size_t lo = 0, hi = last;
+			while (lo<hi) {
+				auto mid = lo+(hi-lo)/2;
+				if (old_offset(mid+1)<begin) lo = mid+1;
+				else hi = mid;
+			}
+			auto restart = lo;
+
+			auto [old_end_lix, old_end_cix] = position(old_end);
+			auto [new_end_lix, new_end_cix] = next.position(new_end);
+			auto res = token_diff{
+				.prefix = restart,
+				.old_suffix = old_tokens.size(),
+				.new_suffix = 0,
+				.old_end_lix = old_end_lix, .old_end_cix = old_end_cix,
+				.new_end_lix = new_end_lix, .new_end_cix = new_end_cix};
+
+			tokens.reserve(old_tokens.size());
+			for (size_t ix=0; ix<restart; ++ix) tokens.push_back(old_tokens[ix].clone());
+
+			auto start = offset((size_t)old_tokens[restart].lix, (size_t)old_tokens[restart].cix);
+			string_view_buf buf(std::string_view(next.text).substr(start));
+			std::istream istr(&buf);
+
+			hill::lexer lexer;
+			lexer.lix = old_tokens[restart].lix;
+			lexer.cix = old_tokens[restart].cix;
+
+			size_t old_ix = restart;
+			while (true) {
+				// The lexer may count a position past the end of the text, that is no token boundary
+				auto at = next.offset((size_t)lexer.lix, (size_t)lexer.cix);
+				if (at>=new_end && next.position(at)==std::make_pair(lexer.lix, lexer.cix)) {
+					// Past the edit the text is the same, a token starting where one started before resynchronizes
+					auto old_at = at-new_end+old_end;
+					while (old_ix<last && old_offset(old_ix)<old_at) ++old_ix;
+					if (old_offset(old_ix)==old_at) {
+						res.old_suffix = old_ix;
+						res.new_suffix = tokens.size();
+						for (; old_ix<=last; ++old_ix) {
+							auto t = old_tokens[old_ix].clone();
+							res.move(t.lix, t.cix);
+							tokens.push_back(std::move(t));
+						}
+						return res;
+					}
+				}
+
+				try {
+					auto t = lexer.get_token(istr);
+					if (t.end()) break;
+					tokens.push_back(std::move(t));
+				} catch (const hill::exception &) {
+					break;
+				}
+			}
+
+			tokens.push_back(token(tt::END, "", lexer.lix, lexer.cix));
+			res.new_suffix = tokens.size();
+			return res;
+		}
+
+	private:
+		struct cached {
+			std::shared_ptr<const void> data;
+			const char *artifact;
+			size_t bytes;
+		};
+
+		std::vector<size_t> line_starts;
+		memory_budget *budget;
+
+		mutable std::mutex cache_mutex;
+		mutable std::shared_ptr<const std::vector<token>> lexed;
+		mutable std::map<std::type_index, cached> derived_cache;
+		mutable std::map<std::type_index, std::shared_ptr<const void>> previous_cache;
+		std::optional<token_diff> diff;
+		mutable std::atomic<size_t> cached_bytes = 0;
+		mutable std::atomic<uint64_t> last_used = 0;
+
+		void touch() const
+		{
+			static std::atomic<uint64_t> clock = 0;
+			last_used = clock.fetch_add(1, std::memory_order_relaxed)+1;
+		}
+
+		/**
+		 * The cache lock must be held
+		 */
+		void account(const char *artifact, size_t bytes) const
+		{
+			cached_bytes += bytes;
+			if (budget) budget->add(artifact, bytes);
+		}
+	};
+
 	struct document_store {
 		document_store() = default;
 
-		/*bool contains(const std::string &fpath)
+		lsp::memory_budget memory_budget;
+		std::function<void(const std::string &uri)> on_evict; // Drops what other caches hold for an evicted document
+
+		std::shared_ptr<const document> get(const std::string &uri)
 		{
+			trim(uri);
+
 			std::lock_guard<std::mutex> guard(access_mutex);
-			return store.contains(fpath);
-		}*/
+			auto it = store.find(uri);
+			return it==store.end() ? nullptr : it->second;
+		}
 
-		std::optional<std::string> get(const std::string &fpath)
+		/**
+		 * Replace the whole text. If the document is open, only the part that differs is treated as edited.
+		 */
+		void set(const std::string &uri, int version, const std::string &content)
 		{
-			std::lock_guard<std::mutex> guard(access_mutex);
-			if (!store.contains(fpath)) return {};
-			else return store.at(fpath);
+			std::shared_ptr<const document> doc;
+			if (auto prev = get(uri)) {
+				std::string_view a = prev->text, b = content;
+				size_t prefix = 0;
+				while (prefix<a.size() && prefix<b.size() && a[prefix]==b[prefix]) ++prefix;
+				size_t suffix = 0;
+				while (suffix<a.size()-prefix && suffix<b.size()-prefix && a[a.size()-1-suffix]==b[b.size()-1-suffix]) ++suffix;
+
+				doc = prev->edit(prefix, a.size()-suffix, b.substr(prefix, b.size()-prefix-suffix), version, &memory_budget);
+			} else {
+				doc = std::make_shared<const document>(uri, version, content, &memory_budget);
+			}
+			put(uri, doc);
+		}
+
+		/**
+		 * Replace the text between two offsets of the current version
+		 */
+		bool edit(const std::string &uri, int version, size_t begin, size_t end, const std::string &replacement)
+		{
+			auto prev = get(uri);
+			if (!prev) return false;
+			put(uri, prev->edit(begin, end, replacement, version, &memory_budget));
+			return true;
 		}
 
-		void set(const std::string &fpath, const std::string &content)
+		bool remove(const std::string &uri)
 		{
 			std::lock_guard<std::mutex> guard(access_mutex);
-			store[fpath] = content;
+			return store.erase(uri)>0;
 		}
 
-		bool remove(const std::string &fpath)
+		/**
+		 * Every open document
+		 */
+		std::vector<std::shared_ptr<const document>> all()
 		{
 			std::lock_guard<std::mutex> guard(access_mutex);
-			if (!store.contains(fpath)) return false;
+			std::vector<std::shared_ptr<const document>> docs;
+			docs.reserve(store.size());
+			for (const auto &[uri, doc] : store) docs.push_back(doc);
+			return docs;
+		}
 
-			store.erase(fpath);
-			return true;
+		size_t size()
+		{
+			std::lock_guard<std::mutex> guard(access_mutex);
+			return store.size();
 		}
 
 	private:
 		std::mutex access_mutex;
-		std::unordered_map<std::string, std::string> store;
+		std::unordered_map<std::string, std::shared_ptr<const document>> store;
+
+		void put(const std::string &uri, const std::shared_ptr<const document> &doc)
+		{
+			{
+				std::lock_guard<std::mutex> guard(access_mutex);
+				store[uri] = doc;
+			}
+
+			trim(uri);
+		}
+
+		/**
+		 * Evict least recently used documents until the caches are under the budget again.
+		 * Goes down to 3/4 of the limit so it does not run on every request near the limit.
+		 * The document being accessed is kept.
+		 */
+		void trim(const std::string &keep_uri)
+		{
+			if (!memory_budget.over()) return;
+
+			std::vector<std::shared_ptr<const document>> docs;
+			{
+				std::lock_guard<std::mutex> guard(access_mutex);
+				for (const auto &[uri, doc] : store) {
+					if (uri!=keep_uri && doc->get_cached_bytes()>0) docs.push_back(doc);
+				}
+			}
+			std::sort(docs.begin(), docs.end(), [](const auto &a, const auto &b) {return a->get_last_used() < b->get_last_used();});
+
+			auto target = memory_budget.get_limit()/4*3;
+			for (const auto &doc : docs) {
+				if (memory_budget.used()<=target) break;
+				memory_budget.on_evict(doc->evict());
+				if (on_evict) on_evict(doc->uri);
+			}
+		}
 	};
 }
 
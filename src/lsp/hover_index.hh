@@ -0,0 +1,136 @@
+#ifndef HILL__LSP__HOVER_INDEX_HH_INCLUDED
+#define HILL__LSP__HOVER_INDEX_HH_INCLUDED
+
+#include "analysis.hh"
+#include "document_store.hh"
+#include "../instr.hh"
+#include "../token.hh"
+#include "../val_ref.hh"
+#include "../utils/cancellation_token.hh"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace hill::lsp {
+
+	/**
+	 * Analyzed type of each token span in one document version, looked up by position
+	 */
+	struct hover_index {
+		static constexpr const char *ARTIFACT = "hover_index";
+
+		struct span {
+			int lix, cix_begin, cix_end;
+			std::string text;
+			std::string type_str;
+			std::optional<val_ref> ref = {}; // The value a name was resolved to
+			bool is_binding = false; // Left side of :=
+		};
+
+		/**
+		 * All spans in text order
+		 */
+		const std::vector<span> &all() const {return spans;}
+
+		/**
+		 * The span covering the position, if any
+		 */
+		const span *find(int lix, int cix) const
+		{
+			auto it = std::upper_bound(spans.begin(), spans.end(), std::tie(lix, cix),
+				[](const std::tuple<int &, int &> &pos, const span &s) {return pos < std::tie(s.lix, s.cix_begin);});
+			if (it==spans.begin()) return nullptr;
+			--it;
+			return it->lix==lix && cix<it->cix_end ? &*it : nullptr;
+		}
+
+		size_t approx_bytes() const
+		{
+			size_t bytes = sizeof *this + spans.capacity()*sizeof(span);
+			for (const auto &s : spans) bytes += s.text.capacity() + s.type_str.capacity();
+			return bytes;
+		}
+
+		static std::shared_ptr<const hover_index> get(const document &doc, const utils::cancellation_token &cancellation = {})
+		{
+			return doc.derived<hover_index>([&] {return build(doc, cancellation);});
+		}
+
+	private:
+		std::vector<span> spans; // Sorted by position, never overlapping
+
+		static std::string type_str(const type &t)
+		{
+			try {
+				return t.to_str();
+			} catch (const hill::exception &) {
+				return "";
+			}
+		}
+
+		/**
+		 * Finds the value an instruction was resolved from, the same way block::add found it
+		 */
+		static std::optional<val_ref> find_ref(const scope &s, const std::string &id, const instr &in)
+		{
+			for (const scope *sc=&s; sc; sc=sc->parent.get()) {
+				if (!sc->ids.contains(id)) continue;
+				for (const auto &val : sc->ids.at(id)) {
+					if (val.type!=in.res_type) continue;
+					if (in.op==op_code::LOAD && val.mt==mem_type::STACK && val.ix==in.val.ix) return val;
+					if (in.op==op_code::LOADI && val.mt==mem_type::LITERAL) {
+						if (val.type.first()==basic_type::FUNC ? val.p==in.val.imm_p : val.u32==in.val.imm_u32) return val;
+					}
+				}
+			}
+			return {};
+		}
+
+		static std::shared_ptr<const hover_index> build(const document &doc, const utils::cancellation_token &cancellation)
+		{
+			auto index = std::make_shared<hover_index>();
+			auto analysis = document_analysis::get(doc, cancellation);
+			const auto &instrs = analysis->instrs();
+
+			for (size_t tix=0; tix<analysis->token_instrs.size(); ++tix) {
+				const auto &t = analysis->rpn()[tix];
+				auto iix = analysis->token_instrs[tix];
+				if (iix>=instrs.size() || t.get_text().empty() || t.lix<0) continue;
+
+				const auto &in = instrs[iix];
+				auto s = span{
+					.lix = t.lix,
+					.cix_begin = t.cix,
+					.cix_end = t.cix + (int)t.get_text().size(),
+					.text = t.get_text(),
+					.type_str = type_str(in.res_type)};
+
+				if (t.get_type()==tt::NAME) {
+					if (in.op==op_code::ID) {
+						// Only names bound by := are known, they are followed by the value and the COPY
+						if (iix+2>=instrs.size() || instrs[iix+2].op!=op_code::COPY) continue;
+						const auto &copy = instrs[iix+2];
+						s.type_str = type_str(copy.res_type);
+						s.ref = val_ref(mem_type::STACK, copy.val.ix, copy.res_type);
+						s.is_binding = true;
+					} else {
+						s.ref = find_ref(analysis->locals(), t.get_text(), in);
+					}
+				}
+
+				if (s.type_str.empty()) continue;
+				index->spans.push_back(std::move(s));
+			}
+
+			std::sort(index->spans.begin(), index->spans.end(),
+				[](const span &a, const span &b) {return std::tie(a.lix, a.cix_begin) < std::tie(b.lix, b.cix_begin);});
+			return index;
+		}
+	};
+}
+
+#endif /* HILL__LSP__HOVER_INDEX_HH_INCLUDED */
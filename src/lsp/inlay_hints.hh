@@ -0,0 +1,159 @@
+#ifndef HILL__LSP__INLAY_HINTS_HH_INCLUDED
+#define HILL__LSP__INLAY_HINTS_HH_INCLUDED
+
+#include "document_store.hh"
+#include "hover_index.hh"
+#include "models.hh"
+#include "../token.hh"
+#include "../utils/cancellation_token.hh"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace hill::lsp {
+
+	/**
+	 * Type hints after the name of each := binding, kept per top-level statement.
+	 * A statement is keyed by a hash of the text from the start of the document to its end,
+	 * which covers everything its types can depend on. Statements with an unchanged key
+	 * reuse the hints of the previous version without looking at the new analysis.
+	 */
+	struct inlay_hint_cache {
+		struct hint {
+			uint32_t lix, cix;
+			std::string label;
+		};
+
+		struct statement {
+			uint32_t begin_lix, begin_cix;
+			uint32_t end_lix, end_cix;
+			uint64_t key;
+		};
+
+		/**
+		 * Top-level statements separated by ';', with their keys
+		 */
+		static std::vector<statement> statements(const document &doc, const std::vector<token> &tokens)
+		{
+			std::vector<statement> stmts;
+			uint64_t hash = 0xcbf29ce484222325ull;
+			size_t hashed = 0;
+			int depth = 0;
+			size_t begin = 0;
+
+			auto close = [&](size_t end_ix) {
+				const auto &b = tokens[begin];
+				const auto &e = tokens[end_ix];
+				auto end_offset = doc.offset((size_t)e.lix, (size_t)e.cix);
+				for (; hashed<end_offset; ++hashed) {
+					hash ^= (unsigned char)doc.text[hashed];
+					hash *= 0x100000001b3ull;
+				}
+				stmts.push_back(statement{
+					.begin_lix = (uint32_t)b.lix, .begin_cix = (uint32_t)b.cix,
+					.end_lix = (uint32_t)e.lix, .end_cix = (uint32_t)e.cix,
+					.key = hash});
+			};
+
+			for (size_t ix=0; ix+1<tokens.size(); ++ix) {
+				if (tokens[ix].lgroup()) ++depth;
+				else if (tokens[ix].rgroup() && depth>0) --depth;
+				else if (depth==0 && tokens[ix].get_type()==tt::OP_SEMICOLON) {
+					close(ix+1); // The statement includes its ';'
+					begin = ix+1;
+				}
+			}
+			if (begin+1<tokens.size()) close(tokens.size()-1);
+
+			return stmts;
+		}
+
+		/**
+		 * Hints inside the range, only the statements overlapping it are looked at
+		 */
+		std::vector<hint> get(const document &doc, const models::range &range, const utils::cancellation_token &cancellation)
+		{
+			auto tokens = doc.tokens(cancellation);
+			auto stmts = statements(doc, *tokens);
+
+			std::shared_ptr<const hint_map> prev;
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				auto it = entries.find(doc.uri);
+				if (it!=entries.end()) prev = it->second;
+			}
+
+			std::shared_ptr<const hover_index> index; // Only built if a visible statement changed
+			auto next = std::make_shared<hint_map>();
+			std::vector<hint> res;
+
+			for (const auto &stmt : stmts) {
+				cancellation.throw_if_cancelled();
+
+				bool visible = std::tie(stmt.end_lix, stmt.end_cix) >= std::tie(range.start.line, range.start.character)
+					&& std::tie(stmt.begin_lix, stmt.begin_cix) <= std::tie(range.end.line, range.end.character);
+
+				std::shared_ptr<const std::vector<hint>> hints;
+				if (prev) {
+					auto it = prev->find(stmt.key);
+					if (it!=prev->end()) hints = it->second;
+				}
+
+				if (!hints) {
+					if (!visible) continue;
+
+					if (!index) index = hover_index::get(doc, cancellation);
+					auto computed = std::make_shared<std::vector<hint>>();
+					for (const auto &s : index->all()) {
+						if (!s.is_binding) continue;
+						auto pos = std::make_tuple((uint32_t)s.lix, (uint32_t)s.cix_begin);
+						if (pos < std::tie(stmt.begin_lix, stmt.begin_cix) || pos >= std::tie(stmt.end_lix, stmt.end_cix)) continue;
+						computed->push_back(hint{.lix = (uint32_t)s.lix, .cix = (uint32_t)s.cix_end, .label = ": " + s.type_str});
+					}
+					hints = computed;
+				}
+
+				if (visible) res.insert(res.end(), hints->begin(), hints->end());
+				(*next)[stmt.key] = hints;
+			}
+
+			// Statements only found in older versions are dropped
+			std::lock_guard<std::mutex> guard(mutex);
+			entries[doc.uri] = next;
+			return res;
+		}
+
+		void remove(const std::string &uri)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			entries.erase(uri);
+		}
+
+		size_t approx_bytes()
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			size_t bytes = 0;
+			for (const auto &[uri, map] : entries) {
+				bytes += uri.capacity() + map->bucket_count()*sizeof(void *);
+				for (const auto &[key, hints] : *map) {
+					bytes += sizeof key + sizeof hints + hints->capacity()*sizeof(hint);
+					for (const auto &h : *hints) bytes += h.label.capacity();
+				}
+			}
+			return bytes;
+		}
+
+	private:
+		typedef std::unordered_map<uint64_t, std::shared_ptr<const std::vector<hint>>> hint_map; // By statement key
+
+		std::mutex mutex;
+		std::unordered_map<std::string, std::shared_ptr<const hint_map>> entries;
+	};
+}
+
+#endif /* HILL__LSP__INLAY_HINTS_HH_INCLUDED */
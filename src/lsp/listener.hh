@@ -3,6 +3,8 @@
 
 #include "models.hh"
 #include "logger.hh"
+#include "recorder.hh"
+#include "server_state.hh"
 #include "../exceptions.hh"
 #include "../utils/json_parser.hh"
 
@@ -29,6 +31,8 @@ namespace hill::lsp {
 			auto content = recv_content(*headers);
 			if (!content) return {};
 
+			recorder::record(*content);
+
 			auto json = parse_content(*content);
 			if (!json) return {};
 
@@ -48,6 +52,12 @@ namespace hill::lsp {
 			while (true) {
 				char *p = NULL;
 				if (!fgets(b, MAX_HTTP_HEADER_LENGTH, stdin)) {
+					if (feof(stdin) || ferror(stdin)) {
+						// The client is gone, there is nothing left to receive
+						logger::warn("Input closed");
+						server_state::get().running = false;
+						return {};
+					}
 					continue;
 				}
 
@@ -63,7 +73,7 @@ namespace hill::lsp {
 					headers[b] = p;
 				} else {
 					if (*b) {
-						logger::error("Received line without ':' that is not empty [" + std::string(b) + "]");
+						logger::error([&] {return "Received line without ':' that is not empty [" + std::string(b) + "]";});
 						return {};
 					}
 
@@ -1,10 +1,17 @@
 #ifndef HILL__LSP__LOGGER_HH_INCLUDED
 #define HILL__LSP__LOGGER_HH_INCLUDED
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <concepts>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
-#include <mutex>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <thread>
 
 namespace hill::lsp {
@@ -17,44 +24,82 @@ namespace hill::lsp {
 		CRITICAL,
 	};
 
+	/**
+	 * Asynchronous logger.
+	 *
+	 * Callers push entries into a lock-free ring buffer and a background thread
+	 * formats and writes them in batches. Levels are checked before anything is
+	 * formatted, pass a lambda to defer building the message until it is needed:
+	 *
+	 *   logger::trace([&] {return "Received method<" + method_str + ">";});
+	 */
 	struct logger {
 
 		static void set_log_level(log_level level)
+		{
+			get().level.store(level, std::memory_order_relaxed);
+		}
+
+		static bool enabled(log_level level)
 		{
 			auto &l = get();
-			l.level = level;
+			return l.started.load(std::memory_order_relaxed) && l.level.load(std::memory_order_relaxed) <= level;
 		}
 
 		static void open(const std::filesystem::path &fpath)
 		{
+			auto &l = get();
+			if (l.started) return;
+
 			std::filesystem::create_directories(fpath.parent_path());
-			get().ofs.open(fpath, std::ios::binary);
+			l.ofs.open(fpath, std::ios::binary);
+
+			l.stopping = false;
+			l.drain_thread = std::thread(&logger::drain_loop, &l);
+			l.started = true;
 		}
 
-		static void writeln(const std::string &msg)
+		/**
+		 * Write everything still queued and stop the background thread
+		 */
+		static void close()
 		{
 			auto &l = get();
+			if (!l.started) return;
 
-			auto now = std::chrono::system_clock::now();
+			l.started = false;
+			l.stopping = true;
+			l.wake();
+			l.drain_thread.join();
+			l.ofs.close();
+		}
 
-			std::lock_guard<std::mutex> guard(l.mutex);
+		static void writeln(std::string_view msg) {get().push(nullptr, msg);}
 
-			l.ofs << std::format("{:%T}", now);
-			l.ofs << " - ";
-			l.ofs << '[' << std::setw(5) << std::right << std::this_thread::get_id() << "] ";
-			l.ofs.write(msg.c_str(), msg.size());
-			l.ofs.put('\n');
-			l.ofs.flush();
-		}
+		static void trace(std::string_view msg) {if (enabled(log_level::TRACE)) get().push("[TRACE] ", msg);}
+		static void info(std::string_view msg) {if (enabled(log_level::INFO)) get().push("[INFO] ", msg);}
+		static void warn(std::string_view msg) {if (enabled(log_level::WARN)) get().push("[WARN] ", msg);}
+		static void error(std::string_view msg) {if (enabled(log_level::ERROR)) get().push("[ERROR] ", msg);}
+		static void critical(std::string_view msg) {if (enabled(log_level::CRITICAL)) get().push("[CRITICAL] ", msg);}
 
-		static void trace(const std::string &msg) {if (get().level <= log_level::TRACE) writeln("[TRACE] " + msg);}
-		static void info(const std::string &msg) {if (get().level <= log_level::INFO) writeln("[INFO] " + msg);}
-		static void warn(const std::string &msg) {if (get().level <= log_level::WARN) writeln("[WARN] " + msg);}
-		static void error(const std::string &msg) {if (get().level <= log_level::ERROR) writeln("[ERROR] " + msg);}
-		static void critical(const std::string &msg) {if (get().level <= log_level::CRITICAL) writeln("[CRITICAL] " + msg);}
+		template<typename FN> requires std::invocable<FN &> static void trace(FN &&fn) {if (enabled(log_level::TRACE)) get().push("[TRACE] ", fn());}
+		template<typename FN> requires std::invocable<FN &> static void info(FN &&fn) {if (enabled(log_level::INFO)) get().push("[INFO] ", fn());}
+		template<typename FN> requires std::invocable<FN &> static void warn(FN &&fn) {if (enabled(log_level::WARN)) get().push("[WARN] ", fn());}
+		template<typename FN> requires std::invocable<FN &> static void error(FN &&fn) {if (enabled(log_level::ERROR)) get().push("[ERROR] ", fn());}
+		template<typename FN> requires std::invocable<FN &> static void critical(FN &&fn) {if (enabled(log_level::CRITICAL)) get().push("[CRITICAL] ", fn());}
 
 	private:
-		logger() = default;
+		logger()
+		{
+			for (size_t ix=0; ix<RING_SIZE; ++ix) {
+				ring[ix].seq.store(ix, std::memory_order_relaxed);
+			}
+		}
+
+		~logger()
+		{
+			close();
+		}
 
 		static logger &get()
 		{
@@ -62,10 +107,126 @@ namespace hill::lsp {
 			return l;
 		}
 
+	private:
+		enum {RING_SIZE=4096}; // Must be a power of two
+
+		struct entry {
+			std::chrono::system_clock::time_point time;
+			std::thread::id thread_id;
+			const char *prefix;
+			std::string msg;
+		};
+
+		struct slot {
+			std::atomic<size_t> seq;
+			entry e;
+		};
+
+		/**
+		 * Multiple producer, single consumer push (bounded queue as described by Dmitry Vyukov).
+		 * Drops the entry if the ring is full rather than blocking the caller.
+		 */
+		void push(const char *prefix, std::string_view msg)
+		{
+			size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+			slot *s;
+			while (true) {
+				s = &ring[pos & (RING_SIZE-1)];
+				size_t seq = s->seq.load(std::memory_order_acquire);
+				auto diff = (intptr_t)seq - (intptr_t)pos;
+				if (diff==0) {
+					if (enqueue_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) break;
+				} else if (diff<0) {
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				} else {
+					pos = enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			s->e.time = std::chrono::system_clock::now();
+			s->e.thread_id = std::this_thread::get_id();
+			s->e.prefix = prefix;
+			s->e.msg.assign(msg);
+			s->seq.store(pos+1, std::memory_order_release);
+
+			wake();
+		}
+
+		bool pop(entry &e)
+		{
+			slot &s = ring[dequeue_pos & (RING_SIZE-1)];
+			if (s.seq.load(std::memory_order_acquire) != dequeue_pos+1) return false;
+
+			std::swap(e, s.e);
+			s.seq.store(dequeue_pos+RING_SIZE, std::memory_order_release);
+			++dequeue_pos;
+			return true;
+		}
+
+		/**
+		 * Only a parked drain thread is notified, so logging a line is a syscall at most when the thread sleeps.
+		 * Both sides order their flag against the counter with seq_cst, so either the producer sees the thread
+		 * parked, or the thread sees the new count and does not wait.
+		 */
+		void wake()
+		{
+			signal.fetch_add(1, std::memory_order_seq_cst);
+			if (parked.load(std::memory_order_seq_cst)) signal.notify_one();
+		}
+
+		void drain_loop()
+		{
+			std::ostringstream batch;
+			entry e;
+
+			while (true) {
+				auto seen = signal.load(std::memory_order_acquire);
+
+				size_t cnt = 0;
+				while (pop(e)) {
+					batch << std::format("{:%T}", e.time);
+					batch << " - ";
+					batch << '[' << std::setw(5) << std::right << e.thread_id << "] ";
+					if (e.prefix) batch << e.prefix;
+					batch << e.msg << '\n';
+					++cnt;
+				}
+
+				auto lost = dropped.exchange(0, std::memory_order_relaxed);
+				if (lost) {
+					batch << "[WARN] " << lost << " log messages dropped\n";
+				}
+
+				if (cnt || lost) {
+					auto str = batch.str();
+					ofs.write(str.c_str(), (std::streamsize)str.size());
+					ofs.flush();
+					batch.str("");
+				} else if (stopping) {
+					return;
+				} else {
+					parked.store(true, std::memory_order_seq_cst);
+					if (signal.load(std::memory_order_seq_cst)==seen) signal.wait(seen, std::memory_order_acquire);
+					parked.store(false, std::memory_order_relaxed);
+				}
+			}
+		}
+
 	private:
 		std::ofstream ofs;
-		std::mutex mutex;
-		log_level level = log_level::TRACE;
+		std::atomic<log_level> level = log_level::TRACE;
+
+		std::array<slot, RING_SIZE> ring;
+		std::atomic<size_t> enqueue_pos = 0;
+		size_t dequeue_pos = 0; // Only touched by the drain thread
+		std::atomic<size_t> dropped = 0;
+
+		std::atomic<uint32_t> signal = 0;
+		std::atomic<bool> parked = false; // The drain thread waits, or is about to, on signal
+		std::atomic<bool> started = false;
+		std::atomic<bool> stopping = false;
+		std::thread drain_thread;
 	};
 }
 
@@ -0,0 +1,74 @@
+#ifndef HILL__LSP__MEMORY_BUDGET_HH_INCLUDED
+#define HILL__LSP__MEMORY_BUDGET_HH_INCLUDED
+
+#include "../utils/json.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace hill::lsp {
+
+	/**
+	 * Approximate bytes held by cached per-document artifacts, by kind of artifact.
+	 * Only counts what can be dropped and computed again, the documents themselves are not included.
+	 */
+	struct memory_budget {
+		static constexpr size_t DEFAULT_LIMIT = 256u << 20;
+
+		void set_limit(size_t limit) {this->limit = limit;}
+		size_t get_limit() const {return limit;}
+
+		size_t used() const {return used_bytes;}
+		bool over() const {return used_bytes>limit;}
+
+		void add(const char *artifact, size_t bytes)
+		{
+			used_bytes += bytes;
+			std::lock_guard<std::mutex> guard(mutex);
+			artifacts[artifact] += bytes;
+		}
+
+		void sub(const char *artifact, size_t bytes)
+		{
+			used_bytes -= bytes;
+			std::lock_guard<std::mutex> guard(mutex);
+			artifacts[artifact] -= bytes;
+		}
+
+		void on_evict(size_t bytes)
+		{
+			evictions.fetch_add(1, std::memory_order_relaxed);
+			evicted_bytes.fetch_add(bytes, std::memory_order_relaxed);
+		}
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_num("limit", (double)limit);
+			json->obj_add_num("used", (double)used_bytes);
+			json->obj_add_num("evictions", (double)evictions.load());
+			json->obj_add_num("evictedBytes", (double)evicted_bytes.load());
+
+			auto artifacts_json = *json->obj_add_obj("artifacts");
+			std::lock_guard<std::mutex> guard(mutex);
+			for (const auto &[name, bytes] : artifacts) artifacts_json->obj_add_num(name, (double)bytes);
+			return json;
+		}
+
+	private:
+		std::atomic<size_t> limit = DEFAULT_LIMIT;
+		std::atomic<size_t> used_bytes = 0;
+		std::atomic<uint64_t> evictions = 0;
+		std::atomic<uint64_t> evicted_bytes = 0;
+
+		mutable std::mutex mutex;
+		std::map<std::string, size_t> artifacts;
+	};
+}
+
+#endif /* HILL__LSP__MEMORY_BUDGET_HH_INCLUDED */
@@ -3,10 +3,11 @@
 
 #include "../models.hh"
 #include "../logger.hh"
+#include "../../utils/cancellation_token.hh"
 
 namespace hill::lsp::methods {
 
-	inline std::variant<std::optional<models::result_t>, models::response_error> _request_template(const models::request_message &req)
+	inline std::variant<std::optional<models::result_t>, models::response_error> _request_template(const models::request_message &req, const utils::cancellation_token &cancellation)
 	{
 		throw;
 	}
@@ -10,7 +10,7 @@ namespace hill::lsp::methods {
 	inline void cancel_request(const models::notification_message &notify)
 	{
 		auto params = *models::cancel_params::from_json(*notify.params);
-		logger::info("Received cancellation notification for request id<" + std::to_string(params.id) + ">");
+		logger::info([&] {return "Received cancellation notification for request id<" + std::to_string(params.id) + ">";});
 		server_state::get().request_state.on_cancel(params.id);
 	}
 };
@@ -10,10 +10,33 @@ namespace hill::lsp::methods {
 	/**
 	 * Requset to initialize
 	 */
-	inline std::variant<std::optional<models::result_t>, models::response_error> initialize(const models::request_message &req)
+	inline std::variant<std::optional<models::result_t>, models::response_error> initialize(const models::request_message &req, const utils::cancellation_token &cancellation)
 	{
-		(void)req; // Unused
+		(void)cancellation; // Unused
 		auto &state = server_state::get();
+
+		auto params = req.params ? models::initialize_params::from_json(*req.params) : std::nullopt;
+		if (params) {
+			std::vector<std::string> root_uris;
+			if (params->workspace_folders) {
+				for (const auto &folder : *params->workspace_folders) root_uris.push_back(folder.uri);
+			} else if (params->root_uri) {
+				root_uris.push_back(*params->root_uri);
+			}
+			state.workspace_index.set_roots(root_uris);
+
+			// initializationOptions: {"memoryBudgetMb": 256, "indexCacheDir": "/path/to/dir"}
+			if (params->initialization_options && (*params->initialization_options)->kind()==utils::json_value_kind::OBJECT) {
+				auto budget_json = (*params->initialization_options)->obj_get("memoryBudgetMb");
+				if (budget_json && (*budget_json)->kind()==utils::json_value_kind::NUMBER && *(*budget_json)->num()>0) {
+					state.document_store.memory_budget.set_limit((size_t)(*(*budget_json)->num()*(1u<<20)));
+				}
+				auto cache_dir_json = (*params->initialization_options)->obj_get("indexCacheDir");
+				if (cache_dir_json && (*cache_dir_json)->kind()==utils::json_value_kind::STRING) {
+					state.workspace_index.set_cache_dir(*(*cache_dir_json)->str());
+				}
+			}
+		}
 		models::initialize_result result = {
 			.capabilities = state.server_capabilities,
 			.server_info = models::server_info{
@@ -34,6 +57,8 @@ namespace hill::lsp::methods {
 		auto &state = server_state::get();
 		state.initialized = true;
 		logger::info("Initialized");
+
+		state.workspace_index.start();
 	}
 
 	/**
@@ -49,9 +74,10 @@ namespace hill::lsp::methods {
 	/**
 	 * The server should shut down, but not exit
 	 */
-	inline std::variant<std::optional<models::result_t>, models::response_error> shutdown(const models::request_message &req)
+	inline std::variant<std::optional<models::result_t>, models::response_error> shutdown(const models::request_message &req, const utils::cancellation_token &cancellation)
 	{
 		(void)req; // Unused
+		(void)cancellation; // Unused
 		auto &state = server_state::get();
 		state.initialized = false;
 		logger::info("Shutdown");
@@ -0,0 +1,33 @@
+#ifndef HILL__LSP__METHODS_MEMORY_HH_INCLUDED
+#define HILL__LSP__METHODS_MEMORY_HH_INCLUDED
+
+#include "../models.hh"
+#include "../server_state.hh"
+#include "../../type.hh"
+#include "../../utils/cancellation_token.hh"
+
+namespace hill::lsp::methods {
+
+	/**
+	 * Hill extension, returns the approximate bytes held by caches.
+	 * Per-document artifacts count against the budget, the other caches are reported only.
+	 * The type table is shared by the whole process and unbounded, types are never freed.
+	 */
+	inline std::variant<std::optional<models::result_t>, models::response_error> hill_memory(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		(void)req; // Unused
+		(void)cancellation; // Unused
+		auto &state = server_state::get();
+
+		auto json = state.document_store.memory_budget.json();
+		json->obj_add_num("documents", (double)state.document_store.size());
+		json->obj_add_num("semanticTokensCache", (double)state.semantic_tokens_cache.approx_bytes());
+		json->obj_add_num("inlayHintCache", (double)state.inlay_hint_cache.approx_bytes());
+		json->obj_add_num("workspaceIndex", (double)state.workspace_index.approx_bytes());
+		json->obj_add_num("typeTable", (double)type_table::get().approx_bytes());
+		json->obj_add_num("typeTableTypes", (double)type_table::get().size());
+		return json;
+	}
+};
+
+#endif /* HILL__LSP__METHODS_MEMORY_HH_INCLUDED */
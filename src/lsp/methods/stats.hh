@@ -0,0 +1,21 @@
+#ifndef HILL__LSP__METHODS_STATS_HH_INCLUDED
+#define HILL__LSP__METHODS_STATS_HH_INCLUDED
+
+#include "../models.hh"
+#include "../stats.hh"
+#include "../../utils/cancellation_token.hh"
+
+namespace hill::lsp::methods {
+
+	/**
+	 * Hill extension, returns per method counters and latency percentiles in microseconds
+	 */
+	inline std::variant<std::optional<models::result_t>, models::response_error> hill_stats(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		(void)req; // Unused
+		(void)cancellation; // Unused
+		return server_stats::get().json();
+	}
+};
+
+#endif /* HILL__LSP__METHODS_STATS_HH_INCLUDED */
@@ -3,108 +3,80 @@
 
 #include "../../models.hh"
 #include "../../logger.hh"
+#include "../../analysis.hh"
+#include "../../completion_index.hh"
 #include "../../server_state.hh"
 
+#include <cctype>
+#include <string>
+#include <string_view>
+
 namespace hill::lsp::methods {
 
-	// Requset to initialize
-	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_completion(const models::request_message &req)
+	namespace completion {
+		inline bool is_id_char(char ch) {return std::isalnum((unsigned char)ch) || ch=='_' || ch=='@';}
+
+		/**
+		 * Members of the tuple named before the dot
+		 */
+		inline std::vector<models::completion_item> members(const document_analysis &analysis, std::string_view owner, std::string_view prefix)
+		{
+			std::vector<models::completion_item> items;
+
+			auto val = analysis.locals().find_val_ref(std::string(owner));
+			if (!val || val->type.first()!=basic_type::TUPLE) return items;
+
+			const auto &elms = val->type.desc().elms;
+			for (size_t ix=0; ix<elms.size(); ++ix) {
+				auto name = "_" + std::to_string(ix);
+				if (!std::string_view(name).starts_with(prefix)) continue;
+				items.push_back(models::completion_item{
+					.label = name,
+					.kind = models::completion_item_kind::FIELD,
+					.detail = type::from_id(elms[ix].id).to_str()});
+			}
+			return items;
+		}
+	}
+
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_completion(const models::request_message &req, const utils::cancellation_token &cancellation)
 	{
-		(void)req; // Unused
-		//auto &state = server_state::get();
-		//auto params = *models::text_document_position_params::from_json(*req.params);
-
-		// TODO: We kinda need the document
-		//state.document_store.exists(params.text_document.uri);
-
-		//params.position.line;
-		//params.position.character;
-
-		//auto content = *state.document_store.get(params.text_document.uri);
-		//logger::trace(content);
-
-		 auto result = std::vector<models::completion_item> {
-			{.label="@i8", .kind=models::completion_item_kind::FUNCTION, .detail="8-bit signed integer"},
-			{.label="@i16", .kind=models::completion_item_kind::FUNCTION, .detail="16-bit signed integer"},
-			{.label="@i32", .kind=models::completion_item_kind::FUNCTION, .detail="32-bit signed integer"},
-			{.label="@i64", .kind=models::completion_item_kind::FUNCTION, .detail="64-bit signed integer"},
-			{.label="@i128", .kind=models::completion_item_kind::FUNCTION, .detail="128-bit signed integer"},
-
-			{.label="i8", .kind=models::completion_item_kind::FUNCTION, .detail="8-bit integer"},
-			{.label="i16", .kind=models::completion_item_kind::FUNCTION, .detail="16-bit integer"},
-			{.label="i32", .kind=models::completion_item_kind::FUNCTION, .detail="32-bit integer"},
-			{.label="i64", .kind=models::completion_item_kind::FUNCTION, .detail="64-bit integer"},
-			{.label="i128", .kind=models::completion_item_kind::FUNCTION, .detail="128-bit integer"},
-
-			{.label="@u8", .kind=models::completion_item_kind::FUNCTION, .detail="8-bit unsigned integer"},
-			{.label="@u16", .kind=models::completion_item_kind::FUNCTION, .detail="16-bit unsigned integer"},
-			{.label="@u32", .kind=models::completion_item_kind::FUNCTION, .detail="32-bit unsigned integer"},
-			{.label="@u64", .kind=models::completion_item_kind::FUNCTION, .detail="64-bit unsigned integer"},
-			{.label="@u128", .kind=models::completion_item_kind::FUNCTION, .detail="128-bit unsigned integer"},
-
-			{.label="u8", .kind=models::completion_item_kind::FUNCTION, .detail="8-bit unsigned integer"},
-			{.label="u16", .kind=models::completion_item_kind::FUNCTION, .detail="16-bit unsigned integer"},
-			{.label="u32", .kind=models::completion_item_kind::FUNCTION, .detail="32-bit unsigned integer"},
-			{.label="u64", .kind=models::completion_item_kind::FUNCTION, .detail="64-bit unsigned integer"},
-			{.label="u128", .kind=models::completion_item_kind::FUNCTION, .detail="128-bit unsigned integer"},
-
-			{.label="@f32", .kind=models::completion_item_kind::FUNCTION, .detail="32-bit floating point (single)"},
-			{.label="@f64", .kind=models::completion_item_kind::FUNCTION, .detail="64-bit floating point (double)"},
-
-			{.label="f32", .kind=models::completion_item_kind::FUNCTION, .detail="32-bit floating point (single)"},
-			{.label="f64", .kind=models::completion_item_kind::FUNCTION, .detail="64-bit floating point (double)"},
-
-			{.label="mut", .kind=models::completion_item_kind::FUNCTION, .detail="Mutable modifier"},
-			{.label="@mut", .kind=models::completion_item_kind::FUNCTION, .detail="Mutable modifier"},
-		};
-
-		/*auto example = std::vector<models::completion_item> {
-			{.label = "TEXT", .kind = models::completion_item_kind::TEXT},
-			{
-				.label = "TEXT deprecated",
-				.kind = models::completion_item_kind::TEXT,
-				.tags = {{models::completion_item_tag::DEPRECATED}}},
-			{
-				.label = "TEXT w details",
-				.kind = models::completion_item_kind::TEXT,
-				.detail = "Details go here"},
-			{
-				.label = "TEXT label details",
-				.label_details = models::completion_item_label_details {
-					.detail = "Details",
-					.description = "Description"},
-				.kind = models::completion_item_kind::TEXT},
-			{.label = "METHOD", .kind = models::completion_item_kind::METHOD},
-			{.label = "FUNCTION", .kind = models::completion_item_kind::FUNCTION},
-			{.label = "CONSTRUCTOR", .kind = models::completion_item_kind::CONSTRUCTOR},
-			{.label = "FIELD", .kind = models::completion_item_kind::FIELD},
-			{.label = "VARIABLE", .kind = models::completion_item_kind::VARIABLE},
-			{.label = "CLASS", .kind = models::completion_item_kind::CLASS},
-			{.label = "INTERFACE", .kind = models::completion_item_kind::INTERFACE},
-			{.label = "MODULE", .kind = models::completion_item_kind::MODULE},
-			{.label = "PROPERTY", .kind = models::completion_item_kind::PROPERTY},
-			{.label = "UNIT", .kind = models::completion_item_kind::UNIT},
-			{.label = "VALUE", .kind = models::completion_item_kind::VALUE},
-			{.label = "ENUM", .kind = models::completion_item_kind::ENUM},
-			{.label = "KEYWORD", .kind = models::completion_item_kind::KEYWORD},
-			{.label = "SNIPPET", .kind = models::completion_item_kind::SNIPPET},
-			{.label = "COLOR", .kind = models::completion_item_kind::COLOR},
-			{.label = "FILE", .kind = models::completion_item_kind::FILE},
-			{.label = "REFERENCE", .kind = models::completion_item_kind::REFERENCE},
-			{.label = "FOLDER", .kind = models::completion_item_kind::FOLDER},
-			{.label = "ENUMMEMBER", .kind = models::completion_item_kind::ENUMMEMBER},
-			{.label = "CONSTANT", .kind = models::completion_item_kind::CONSTANT},
-			{.label = "STRUCT", .kind = models::completion_item_kind::STRUCT},
-			{.label = "EVENT", .kind = models::completion_item_kind::EVENT},
-			{.label = "OPERATOR", .kind = models::completion_item_kind::OPERATOR},
-			{.label = "TYPEPARAMETER", .kind = models::completion_item_kind::TYPEPARAMETER}
-		};*/
-
-		models::completion_list completion_list = {
-			.is_incomplete = false,
-			//.items = example,
-			.items = result,
-		};
+		auto &state = server_state::get();
+		auto params = models::text_document_position_params::from_json(*req.params);
+		if (!params) return models::response_error{.code = models::error_code::INVALID_PARAMS, .message = "Invalid params"};
+
+		models::completion_list completion_list = {.is_incomplete = false, .items = {}};
+
+		auto doc = state.document_store.get(params->text_document.uri);
+		if (!doc) return completion_list.json();
+
+		// The word being typed ends at the cursor
+		auto line = doc->line(params->position.line);
+		size_t end = std::min<size_t>(params->position.character, line.size());
+		size_t begin = end;
+		while (begin>0 && completion::is_id_char(line[begin-1])) --begin;
+		auto prefix = line.substr(begin, end-begin);
+
+		if (begin>0 && line[begin-1]=='.') {
+			size_t owner_begin = begin-1;
+			while (owner_begin>0 && completion::is_id_char(line[owner_begin-1])) --owner_begin;
+			auto owner = line.substr(owner_begin, begin-1-owner_begin);
+
+			auto analysis = document_analysis::get(*doc, cancellation);
+			completion_list.items = completion::members(*analysis, owner, prefix);
+			return completion_list.json();
+		}
+
+		auto index = completion_index::get(*doc, cancellation);
+		auto res = index->query(prefix, (int)params->position.line, (int)end);
+
+		completion_list.is_incomplete = res.is_incomplete;
+		for (const auto *e : res.entries) {
+			completion_list.items.push_back(models::completion_item{
+				.label = e->label,
+				.kind = e->kind,
+				.detail = e->detail.empty() ? std::optional<std::string>{} : e->detail});
+		}
 
 		return completion_list.json();
 	}
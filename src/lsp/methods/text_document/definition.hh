@@ -0,0 +1,50 @@
+#ifndef HILL__LSP__METHODS_TEXT_DOCUMENT__DEFINITION_HH_INCLUDED
+#define HILL__LSP__METHODS_TEXT_DOCUMENT__DEFINITION_HH_INCLUDED
+
+#include "../../models.hh"
+#include "../../logger.hh"
+#include "../../server_state.hh"
+#include "../workspace/symbol.hh"
+
+#include <tuple>
+
+namespace hill::lsp::methods {
+
+	/**
+	 * The closest binding of the name before it in the same document,
+	 * otherwise every binding of the name in the workspace
+	 */
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_definition(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		auto &state = server_state::get();
+		auto params = models::text_document_position_params::from_json(*req.params);
+		if (!params) return models::response_error{.code = models::error_code::INVALID_PARAMS, .message = "Invalid params"};
+
+		auto json = utils::json_value::create<utils::json_value_kind::ARRAY>();
+
+		auto doc = state.document_store.get(params->text_document.uri);
+		if (!doc) return json;
+
+		auto symbols = workspace_index::scan(*doc->tokens(cancellation));
+		const auto *sym = workspace_index::symbol_at(symbols, params->position.line, params->position.character);
+		if (!sym) return json;
+
+		const workspace_index::symbol *local = nullptr;
+		for (const auto &s : symbols) {
+			if (std::tie(s.lix, s.cix) > std::tie(sym->lix, sym->cix)) break;
+			if (s.is_binding && s.name==sym->name) local = &s;
+		}
+		if (local) {
+			json->arr_add_obj(to_location(workspace_index::match{.uri = doc->uri, .sym = *local}).json());
+			return json;
+		}
+
+		for (const auto &m : state.workspace_index.find(sym->name, true)) {
+			if (m.uri==doc->uri) continue; // Bound later in this document
+			json->arr_add_obj(to_location(m).json());
+		}
+		return json;
+	}
+}
+
+#endif /* HILL__LSP__METHODS_TEXT_DOCUMENT__DEFINITION_HH_INCLUDED */
@@ -0,0 +1,63 @@
+#ifndef HILL__LSP__METHODS_TEXT_DOCUMENT__DIAGNOSTIC_HH_INCLUDED
+#define HILL__LSP__METHODS_TEXT_DOCUMENT__DIAGNOSTIC_HH_INCLUDED
+
+#include "../../diagnostics.hh"
+#include "../../models.hh"
+#include "../../logger.hh"
+#include "../../server_state.hh"
+#include "../../uri.hh"
+
+namespace hill::lsp::methods {
+
+	/**
+	 * Diagnostics of an open document, or of the file on disk if it is not open.
+	 * Nothing has to be analyzed when the client already has the result for the same text.
+	 */
+	inline std::optional<std::shared_ptr<const document_diagnostics>> diagnostics_for(const std::string &uri, const utils::cancellation_token &cancellation)
+	{
+		auto &state = server_state::get();
+		if (auto doc = state.document_store.get(uri)) return document_diagnostics::get(*doc, cancellation);
+
+		std::string text;
+		if (!workspace_index::read_file(uri::to_path(uri), text)) return {};
+		return document_diagnostics::build(document(uri, 0, text), cancellation);
+	}
+
+	inline models::document_diagnostic_report diagnostic_report(const document_diagnostics &diagnostics, const std::optional<std::string> &previous_result_id)
+	{
+		if (previous_result_id && *previous_result_id==diagnostics.result_id) {
+			return models::document_diagnostic_report{
+				.kind = models::document_diagnostic_report_kind::UNCHANGED,
+				.result_id = diagnostics.result_id};
+		}
+		return models::document_diagnostic_report{
+			.kind = models::document_diagnostic_report_kind::FULL,
+			.result_id = diagnostics.result_id,
+			.items = diagnostics.items};
+	}
+
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_diagnostic(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		auto &state = server_state::get();
+		auto params = models::document_diagnostic_params::from_json(*req.params);
+		if (!params) return models::response_error{.code = models::error_code::INVALID_PARAMS, .message = "Invalid params"};
+
+		const auto &uri = params->text_document.uri;
+
+		// Same text as last time, the result id is known without analyzing
+		if (auto doc = state.document_store.get(uri); doc && params->previous_result_id
+				&& *params->previous_result_id==document_diagnostics::result_id_of(doc->text)) {
+			return models::document_diagnostic_report{
+				.kind = models::document_diagnostic_report_kind::UNCHANGED,
+				.result_id = *params->previous_result_id}.json();
+		}
+
+		auto diagnostics = diagnostics_for(uri, cancellation);
+		if (!diagnostics) return models::document_diagnostic_report{.kind = models::document_diagnostic_report_kind::FULL}.json();
+
+		logger::trace([&] {return "textDocument/diagnostic uri<" + uri + "> items<" + std::to_string((*diagnostics)->items.size()) + ">";});
+		return diagnostic_report(**diagnostics, params->previous_result_id).json();
+	}
+}
+
+#endif /* HILL__LSP__METHODS_TEXT_DOCUMENT__DIAGNOSTIC_HH_INCLUDED */
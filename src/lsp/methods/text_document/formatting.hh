@@ -7,14 +7,26 @@
 
 #include "../../../fmt/formatter.hh"
 
+#include <sstream>
+
 namespace hill::lsp::methods {
 
-	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_formatting(const models::request_message &req)
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_formatting(const models::request_message &req, const utils::cancellation_token &cancellation)
 	{
+		auto &state = server_state::get();
 		auto params = *models::document_formatting_params::from_json(*req.params);
-		(void)params; // Unused
 
-		//auto output = fmt::formatter::format();
+		auto json = utils::json_value::create<utils::json_value_kind::ARRAY>();
+
+		auto doc = state.document_store.get(params.text_document.uri);
+		if (!doc) return json;
+
+		std::istringstream istr(doc->text);
+		auto output = fmt::formatter::format(istr, cancellation);
+		if (output == doc->text) return json;
+
+		// Replace the whole document, the end position is one past the last line
+		auto line_cnt = (uint32_t)doc->line_cnt() - 1u;
 
 		std::vector<models::text_edit> text_edits = {
 			{
@@ -23,14 +35,13 @@ namespace hill::lsp::methods {
 						.line = 0u,
 						.character = 0u},
 					.end = models::position{
-						.line = 0u,
+						.line = line_cnt + 1u,
 						.character = 0u},
 				},
-				.new_text = "Imagine if this actually worked\n\n"
+				.new_text = output
 			}
 		};
 
-		auto json = utils::json_value::create<utils::json_value_kind::ARRAY>();
 		for (const auto &edit: text_edits) {json->arr_add_obj(edit.json());}
 		return json;
 	}
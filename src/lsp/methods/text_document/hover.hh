@@ -3,31 +3,47 @@
 
 #include "../../models.hh"
 #include "../../logger.hh"
+#include "../../hover_index.hh"
 #include "../../server_state.hh"
 
 namespace hill::lsp::methods {
 
-	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_hover(const models::request_message &req)
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_hover(const models::request_message &req, const utils::cancellation_token &cancellation)
 	{
-		using namespace std::literals::string_literals;
-
+		auto &state = server_state::get();
 		auto params = *models::hover_params::from_json(*req.params);
 
-		//params.text_document.uri
+		auto doc = state.document_store.get(params.text_document.uri);
+		if (!doc) return utils::json_value::create<utils::json_value_kind::JSON_NULL>();
+
+		// Built once per version, a hover only does the lookup
+		auto index = hover_index::get(*doc, cancellation);
+		const auto *span = index->find((int)params.position.line, (int)params.position.character);
+		if (!span) return utils::json_value::create<utils::json_value_kind::JSON_NULL>();
+
+		std::string value = "```hill\n" + span->text + ": " + span->type_str + "\n```";
+		if (span->ref) {
+			switch (span->ref->mt) {
+			case mem_type::STACK:
+				value += span->is_binding ? "\n\nLocal binding" : "\n\nLocal";
+				value += ", stack offset " + std::to_string(span->ref->ix);
+				break;
+			case mem_type::LITERAL:
+				value += "\n\nBuiltin";
+				break;
+			default:
+				break;
+			}
+		}
 
 		auto res = models::hover {
 			.contents = models::markup_content {
 				.kind = models::markup_kind::MARKDOWN,
-				.value =
-R"(### This is a hover
-
-```typescript
-someCode();
-```
-
-Uri: ")" + params.text_document.uri
-+ "\"\\\nLine: "s + std::to_string(params.position.line)
-+ "\\\nChar: "s + std::to_string(params.position.character)
+				.value = value,
+			},
+			.range = models::range{
+				.start = {.line = (uint32_t)span->lix, .character = (uint32_t)span->cix_begin},
+				.end = {.line = (uint32_t)span->lix, .character = (uint32_t)span->cix_end},
 			},
 		};
 		return res.json();
@@ -0,0 +1,34 @@
+#ifndef HILL__LSP__METHODS_TEXT_DOCUMENT__INLAY_HINT_HH_INCLUDED
+#define HILL__LSP__METHODS_TEXT_DOCUMENT__INLAY_HINT_HH_INCLUDED
+
+#include "../../models.hh"
+#include "../../logger.hh"
+#include "../../server_state.hh"
+
+namespace hill::lsp::methods {
+
+	/**
+	 * The inferred type after the name of each binding in the visible range
+	 */
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_inlay_hint(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		auto &state = server_state::get();
+		auto params = models::inlay_hint_params::from_json(*req.params);
+		if (!params) return models::response_error{.code = models::error_code::INVALID_PARAMS, .message = "Invalid params"};
+
+		auto json = utils::json_value::create<utils::json_value_kind::ARRAY>();
+
+		auto doc = state.document_store.get(params->text_document.uri);
+		if (!doc) return json;
+
+		for (const auto &hint : state.inlay_hint_cache.get(*doc, params->range, cancellation)) {
+			json->arr_add_obj(models::inlay_hint{
+				.position = {.line = hint.lix, .character = hint.cix},
+				.label = hint.label,
+				.kind = models::inlay_hint_kind::TYPE}.json());
+		}
+		return json;
+	}
+}
+
+#endif /* HILL__LSP__METHODS_TEXT_DOCUMENT__INLAY_HINT_HH_INCLUDED */
@@ -0,0 +1,38 @@
+#ifndef HILL__LSP__METHODS_TEXT_DOCUMENT__REFERENCES_HH_INCLUDED
+#define HILL__LSP__METHODS_TEXT_DOCUMENT__REFERENCES_HH_INCLUDED
+
+#include "../../models.hh"
+#include "../../logger.hh"
+#include "../../server_state.hh"
+#include "../workspace/symbol.hh"
+
+namespace hill::lsp::methods {
+
+	/**
+	 * Every use of the name under the cursor in the workspace
+	 */
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_references(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		auto &state = server_state::get();
+		auto params = models::reference_params::from_json(*req.params);
+		if (!params) return models::response_error{.code = models::error_code::INVALID_PARAMS, .message = "Invalid params"};
+
+		auto json = utils::json_value::create<utils::json_value_kind::ARRAY>();
+
+		auto doc = state.document_store.get(params->text_document.uri);
+		if (!doc) return json;
+
+		auto symbols = workspace_index::scan(*doc->tokens(cancellation));
+		const auto *sym = workspace_index::symbol_at(symbols, params->position.line, params->position.character);
+		if (!sym) return json;
+
+		for (const auto &m : state.workspace_index.find(sym->name, false)) {
+			cancellation.throw_if_cancelled();
+			if (!params->include_declaration && m.sym.is_binding) continue;
+			json->arr_add_obj(to_location(m).json());
+		}
+		return json;
+	}
+}
+
+#endif /* HILL__LSP__METHODS_TEXT_DOCUMENT__REFERENCES_HH_INCLUDED */
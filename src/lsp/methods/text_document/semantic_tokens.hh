@@ -0,0 +1,49 @@
+#ifndef HILL__LSP__METHODS_TEXT_DOCUMENT__SEMANTIC_TOKENS_HH_INCLUDED
+#define HILL__LSP__METHODS_TEXT_DOCUMENT__SEMANTIC_TOKENS_HH_INCLUDED
+
+#include "../../models.hh"
+#include "../../logger.hh"
+#include "../../semantic_tokens.hh"
+#include "../../server_state.hh"
+
+namespace hill::lsp::methods {
+
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_semantic_tokens_full(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		auto &state = server_state::get();
+		auto params = *models::semantic_tokens_params::from_json(*req.params);
+
+		auto doc = state.document_store.get(params.text_document.uri);
+		if (!doc) return models::semantic_tokens{}.json();
+
+		auto result = state.semantic_tokens_cache.update(*doc, cancellation);
+		return models::semantic_tokens{.result_id = result.id, .data = *result.data}.json();
+	}
+
+	/**
+	 * Only the changed range is sent if the client still has the last result, otherwise all tokens
+	 */
+	inline std::variant<std::optional<models::result_t>, models::response_error> text_document_semantic_tokens_full_delta(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		auto &state = server_state::get();
+		auto params = *models::semantic_tokens_delta_params::from_json(*req.params);
+
+		auto doc = state.document_store.get(params.text_document.uri);
+		if (!doc) return models::semantic_tokens{}.json();
+
+		auto prev = state.semantic_tokens_cache.get(doc->uri);
+		auto result = state.semantic_tokens_cache.update(*doc, cancellation);
+
+		if (!prev || prev->id!=params.previous_result_id) {
+			logger::trace([&] {return "semanticTokens/full/delta unknown previous result<" + params.previous_result_id + ">";});
+			return models::semantic_tokens{.result_id = result.id, .data = *result.data}.json();
+		}
+
+		return models::semantic_tokens_delta{
+			.result_id = result.id,
+			.edits = semantic_tokens::diff(*prev->data, *result.data),
+		}.json();
+	}
+}
+
+#endif /* HILL__LSP__METHODS_TEXT_DOCUMENT__SEMANTIC_TOKENS_HH_INCLUDED */
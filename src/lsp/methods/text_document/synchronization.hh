@@ -11,10 +11,15 @@ namespace hill::lsp::methods {
 
 	inline void text_document_did_open(const models::notification_message &req)
 	{
+		auto &state = server_state::get();
+
 		auto params = *models::did_open_text_document_params::from_json(*req.params);
 
-		logger::trace("textDocument/didOpen Uri<" + params.text_document.uri
-			+ "> langId<" + params.text_document.language_id + ">");
+		logger::trace([&] {return "textDocument/didOpen Uri<" + params.text_document.uri
+			+ "> langId<" + params.text_document.language_id + ">";});
+
+		state.document_store.set(params.text_document.uri, params.text_document.version, params.text_document.text);
+		if (auto doc = state.document_store.get(params.text_document.uri)) state.workspace_index.update(*doc);
 	}
 
 	inline void text_document_did_change(const models::notification_message &req)
@@ -25,11 +30,35 @@ namespace hill::lsp::methods {
 
 		auto params = *models::did_change_text_document_params::from_json(*req.params);
 
+		const auto &uri = params.text_document.uri;
+		auto version = params.text_document.version;
+
 		if (text_document_sync == models::text_document_sync_kind::FULL) {
-			logger::trace("textDocument/didChange kind<Full> uri<" + params.text_document.uri + ">");
-			state.document_store.set(params.text_document.uri, params.content_changes.back().text);
+			logger::trace([&] {return "textDocument/didChange kind<Full> uri<" + uri + ">";});
+			state.document_store.set(uri, version, params.content_changes.back().text);
+			if (auto doc = state.document_store.get(uri)) state.workspace_index.update(*doc);
+		} else if (text_document_sync == models::text_document_sync_kind::INCREMENTAL) {
+			logger::trace([&] {return "textDocument/didChange kind<Incremental> uri<" + uri + "> changes<" + std::to_string(params.content_changes.size()) + ">";});
+
+			// Applied in order, each range is in the text left by the change before it
+			for (const auto &change : params.content_changes) {
+				if (!change.range) {
+					state.document_store.set(uri, version, change.text);
+					continue;
+				}
+
+				auto doc = state.document_store.get(uri);
+				if (!doc) {
+					logger::error([&] {return "textDocument/didChange on a document that is not open uri<" + uri + ">";});
+					return;
+				}
+				auto begin = doc->offset(change.range->start.line, change.range->start.character);
+				auto end = doc->offset(change.range->end.line, change.range->end.character);
+				state.document_store.edit(uri, version, begin, end, change.text);
+			}
+			if (auto doc = state.document_store.get(uri)) state.workspace_index.update(*doc);
 		} else {
-			logger::error("textDocument/didChange Unknown kind<" + std::to_string((int)text_document_sync) + ">");
+			logger::error([&] {return "textDocument/didChange Unknown kind<" + std::to_string((int)text_document_sync) + ">";});
 		}
 	}
 
@@ -43,9 +72,12 @@ namespace hill::lsp::methods {
 
 		auto params = *models::did_close_text_document_params::from_json(*req.params);
 
-		logger::trace("textDocument/didClose uri<" + params.text_document.uri + ">");
+		logger::trace([&] {return "textDocument/didClose uri<" + params.text_document.uri + ">";});
 
 		state.document_store.remove(params.text_document.uri);
+		state.semantic_tokens_cache.remove(params.text_document.uri);
+		state.inlay_hint_cache.remove(params.text_document.uri);
+		state.workspace_index.close(params.text_document.uri);
 	}
 
 	// Rename
@@ -0,0 +1,136 @@
+#ifndef HILL__LSP__METHODS_WORKSPACE__DIAGNOSTIC_HH_INCLUDED
+#define HILL__LSP__METHODS_WORKSPACE__DIAGNOSTIC_HH_INCLUDED
+
+#include "../../diagnostics.hh"
+#include "../../models.hh"
+#include "../../logger.hh"
+#include "../../server_state.hh"
+#include "../../writer.hh"
+#include "../text_document/diagnostic.hh"
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace hill::lsp::methods {
+
+	/**
+	 * Reports for every open document and every indexed file, computed in parallel.
+	 * Files whose result id the client already has are answered as unchanged.
+	 * Closed files are compared by the content hash in the workspace index and only read when it differs.
+	 * With a partial result token, finished reports are streamed with $/progress while the rest is computed.
+	 * Once a batch went out, the last reports go out the same way and the response itself is empty.
+	 */
+	inline std::variant<std::optional<models::result_t>, models::response_error> workspace_diagnostic(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		constexpr size_t PARTIAL_BATCH = 64;
+
+		auto &state = server_state::get();
+		auto params = models::workspace_diagnostic_params::from_json(*req.params);
+		if (!params) return models::response_error{.code = models::error_code::INVALID_PARAMS, .message = "Invalid params"};
+
+		std::unordered_map<std::string, std::string> previous;
+		for (const auto &prev : params->previous_result_ids) previous[prev.uri] = prev.value;
+
+		struct work_item {
+			std::string uri;
+			std::shared_ptr<const document> doc; // Open documents
+			uint64_t hash = 0; // Closed files, as last indexed
+		};
+
+		std::vector<work_item> work;
+		std::unordered_set<std::string> open_uris;
+		for (auto &doc : state.document_store.all()) {
+			open_uris.insert(doc->uri);
+			work.push_back(work_item{.uri = doc->uri, .doc = std::move(doc)});
+		}
+		for (auto &[uri, hash] : state.workspace_index.file_hashes()) {
+			if (!open_uris.contains(uri)) work.push_back(work_item{.uri = std::move(uri), .doc = nullptr, .hash = hash});
+		}
+
+		std::mutex done_mutex;
+		std::vector<models::document_diagnostic_report> done;
+		bool sent_partial = false; // Only touched on this thread
+
+		auto send_partial = [&](const std::vector<models::document_diagnostic_report> &batch) {
+			auto value = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			auto items = *value->obj_add_arr("items");
+			for (const auto &report : batch) items->arr_add_obj(report.json());
+
+			writer::send(models::notification_message{
+				.method = models::method::PROGRESS,
+				.params = models::progress_params{.token = *params->partial_result_token, .value = value}.json()});
+			sent_partial = true;
+		};
+
+		parallel_for(state.thread_pool.load(), work.size(), [&](size_t ix) {
+			if (cancellation.cancelled()) return;
+
+			const auto &item = work[ix];
+			auto it = previous.find(item.uri);
+			auto previous_result_id = it==previous.end() ? std::optional<std::string>{} : std::optional<std::string>{it->second};
+
+			std::optional<models::document_diagnostic_report> report;
+			try {
+				if (!item.doc && previous_result_id && *previous_result_id==document_diagnostics::result_id_of(item.hash)) {
+					report = models::document_diagnostic_report{
+						.kind = models::document_diagnostic_report_kind::UNCHANGED,
+						.result_id = *previous_result_id};
+				} else if (item.doc) {
+					report = diagnostic_report(*document_diagnostics::get(*item.doc, cancellation), previous_result_id);
+				} else if (auto diagnostics = diagnostics_for(item.uri, cancellation)) {
+					report = diagnostic_report(**diagnostics, previous_result_id);
+				} else {
+					return; // Gone from disk
+				}
+			} catch (const cancelled_exception &) {
+				return;
+			} catch (const std::exception &e) {
+				// The file is still reported, without a result id so the client asks again next time
+				logger::error([&] {return "workspace/diagnostic failed for " + item.uri + ": " + e.what();});
+				report = models::document_diagnostic_report{
+					.kind = models::document_diagnostic_report_kind::FULL,
+					.items = {models::diagnostic{
+						.range = {.start = {.line = 0, .character = 0}, .end = {.line = 0, .character = 0}},
+						.severity = models::diagnostic_severity::WARNING,
+						.source = "hill",
+						.message = std::string("Analysis failed: ") + e.what()}}};
+			}
+
+			report->uri = item.uri;
+			if (item.doc) report->version = item.doc->version;
+
+			std::lock_guard<std::mutex> guard(done_mutex);
+			done.push_back(std::move(*report));
+		}, [&] {
+			if (!params->partial_result_token || cancellation.cancelled()) return;
+
+			std::vector<models::document_diagnostic_report> batch;
+			{
+				std::lock_guard<std::mutex> guard(done_mutex);
+				if (done.size()<PARTIAL_BATCH) return;
+				std::swap(batch, done);
+			}
+			send_partial(batch);
+		});
+
+		cancellation.throw_if_cancelled();
+
+		logger::trace([&] {return "workspace/diagnostic documents<" + std::to_string(work.size()) + ">";});
+
+		// The client has taken the partial results as the response, the rest has to follow them
+		if (sent_partial && !done.empty()) send_partial(done);
+
+		auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+		auto items = *json->obj_add_arr("items");
+		if (!sent_partial) {
+			for (const auto &report : done) items->arr_add_obj(report.json());
+		}
+		return json;
+	}
+}
+
+#endif /* HILL__LSP__METHODS_WORKSPACE__DIAGNOSTIC_HH_INCLUDED */
@@ -0,0 +1,54 @@
+#ifndef HILL__LSP__METHODS_WORKSPACE__SYMBOL_HH_INCLUDED
+#define HILL__LSP__METHODS_WORKSPACE__SYMBOL_HH_INCLUDED
+
+#include "../../models.hh"
+#include "../../logger.hh"
+#include "../../server_state.hh"
+
+namespace hill::lsp::methods {
+
+	inline models::location to_location(const workspace_index::match &m)
+	{
+		return models::location{
+			.uri = m.uri,
+			.range = models::range{
+				.start = {.line = m.sym.lix, .character = m.sym.cix},
+				.end = {.line = m.sym.lix, .character = m.sym.cix + (uint32_t)m.sym.name.size()},
+			},
+		};
+	}
+
+	inline std::variant<std::optional<models::result_t>, models::response_error> workspace_symbol(const models::request_message &req, const utils::cancellation_token &cancellation)
+	{
+		(void)cancellation; // Unused
+		constexpr size_t MAX_SYMBOLS = 1000;
+
+		auto &state = server_state::get();
+		auto params = models::workspace_symbol_params::from_json(*req.params);
+		if (!params) return models::response_error{.code = models::error_code::INVALID_PARAMS, .message = "Invalid params"};
+
+		// Answered from what is indexed so far while the initial build is running
+		auto json = utils::json_value::create<utils::json_value_kind::ARRAY>();
+		for (const auto &m : state.workspace_index.search(params->query, MAX_SYMBOLS)) {
+			json->arr_add_obj(models::symbol_information{
+				.name = m.sym.name,
+				.kind = models::symbol_kind::VARIABLE,
+				.location = to_location(m)}.json());
+		}
+		return json;
+	}
+
+	inline void workspace_did_change_watched_files(const models::notification_message &notify)
+	{
+		auto &state = server_state::get();
+		auto params = models::did_change_watched_files_params::from_json(*notify.params);
+		if (!params) return;
+
+		for (const auto &change : params->changes) {
+			logger::trace([&] {return "workspace/didChangeWatchedFiles uri<" + change.uri + "> type<" + std::to_string((int)change.type) + ">";});
+			state.workspace_index.file_changed(change.uri, change.type);
+		}
+	}
+}
+
+#endif /* HILL__LSP__METHODS_WORKSPACE__SYMBOL_HH_INCLUDED */
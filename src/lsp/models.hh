@@ -32,10 +32,24 @@ namespace hill::lsp::models {
 		TEXT_DOCUMENT_DID_SAVE,
 		TEXT_DOCUMENT_DID_CLOSE,
 		WORKSPACE_DOCUMENT_DID_RENAME,
+		WORKSPACE_DID_CHANGE_WATCHED_FILES,
+		// Workspace
+		WORKSPACE_SYMBOL,
 		// Text document
 		TEXT_DOCUMENT_COMPLETION,
 		TEXT_DOCUMENT_HOVER,
+		TEXT_DOCUMENT_DEFINITION,
+		TEXT_DOCUMENT_REFERENCES,
 		TEXT_DOCUMENT_FORMATTING,
+		TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL,
+		TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL_DELTA,
+		TEXT_DOCUMENT_INLAY_HINT,
+		TEXT_DOCUMENT_DIAGNOSTIC,
+		WORKSPACE_DIAGNOSTIC,
+		PROGRESS,
+		// Hill extensions
+		HILL_STATS,
+		HILL_MEMORY,
 	};
 
 	constexpr const char *method_str(method m)
@@ -57,9 +71,21 @@ namespace hill::lsp::models {
 		case method::TEXT_DOCUMENT_DID_SAVE: return "textDocument/didSave";
 		case method::TEXT_DOCUMENT_DID_CLOSE: return "textDocument/didClose";
 		case method::WORKSPACE_DOCUMENT_DID_RENAME: return "workspace/didRenameFiles";
+		case method::WORKSPACE_DID_CHANGE_WATCHED_FILES: return "workspace/didChangeWatchedFiles";
+		case method::WORKSPACE_SYMBOL: return "workspace/symbol";
 		case method::TEXT_DOCUMENT_COMPLETION: return "textDocument/completion";
 		case method::TEXT_DOCUMENT_HOVER: return "textDocument/hover";
+		case method::TEXT_DOCUMENT_DEFINITION: return "textDocument/definition";
+		case method::TEXT_DOCUMENT_REFERENCES: return "textDocument/references";
 		case method::TEXT_DOCUMENT_FORMATTING: return "textDocument/formatting";
+		case method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL: return "textDocument/semanticTokens/full";
+		case method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL_DELTA: return "textDocument/semanticTokens/full/delta";
+		case method::TEXT_DOCUMENT_INLAY_HINT: return "textDocument/inlayHint";
+		case method::TEXT_DOCUMENT_DIAGNOSTIC: return "textDocument/diagnostic";
+		case method::WORKSPACE_DIAGNOSTIC: return "workspace/diagnostic";
+		case method::PROGRESS: return "$/progress";
+		case method::HILL_STATS: return "$/hill/stats";
+		case method::HILL_MEMORY: return "$/hill/memory";
 		default: throw internal_exception();
 		}
 	}
@@ -80,9 +106,21 @@ namespace hill::lsp::models {
 		else if (str==method_str(method::TEXT_DOCUMENT_DID_SAVE)) return method::TEXT_DOCUMENT_DID_SAVE;
 		else if (str==method_str(method::TEXT_DOCUMENT_DID_CLOSE)) return method::TEXT_DOCUMENT_DID_CLOSE;
 		else if (str==method_str(method::WORKSPACE_DOCUMENT_DID_RENAME)) return method::WORKSPACE_DOCUMENT_DID_RENAME;
+		else if (str==method_str(method::WORKSPACE_DID_CHANGE_WATCHED_FILES)) return method::WORKSPACE_DID_CHANGE_WATCHED_FILES;
+		else if (str==method_str(method::WORKSPACE_SYMBOL)) return method::WORKSPACE_SYMBOL;
 		else if (str==method_str(method::TEXT_DOCUMENT_COMPLETION)) return method::TEXT_DOCUMENT_COMPLETION;
 		else if (str==method_str(method::TEXT_DOCUMENT_HOVER)) return method::TEXT_DOCUMENT_HOVER;
+		else if (str==method_str(method::TEXT_DOCUMENT_DEFINITION)) return method::TEXT_DOCUMENT_DEFINITION;
+		else if (str==method_str(method::TEXT_DOCUMENT_REFERENCES)) return method::TEXT_DOCUMENT_REFERENCES;
 		else if (str==method_str(method::TEXT_DOCUMENT_FORMATTING)) return method::TEXT_DOCUMENT_FORMATTING;
+		else if (str==method_str(method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL)) return method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL;
+		else if (str==method_str(method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL_DELTA)) return method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL_DELTA;
+		else if (str==method_str(method::TEXT_DOCUMENT_INLAY_HINT)) return method::TEXT_DOCUMENT_INLAY_HINT;
+		else if (str==method_str(method::TEXT_DOCUMENT_DIAGNOSTIC)) return method::TEXT_DOCUMENT_DIAGNOSTIC;
+		else if (str==method_str(method::WORKSPACE_DIAGNOSTIC)) return method::WORKSPACE_DIAGNOSTIC;
+		else if (str==method_str(method::PROGRESS)) return method::PROGRESS;
+		else if (str==method_str(method::HILL_STATS)) return method::HILL_STATS;
+		else if (str==method_str(method::HILL_MEMORY)) return method::HILL_MEMORY;
 		else return {};
 	}
 
@@ -225,6 +263,15 @@ namespace hill::lsp::models {
 	struct notification_message {
 		models::method method;
 		std::optional<std::shared_ptr<::hill::utils::json_value>> params = {};
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_str("jsonrpc", "2.0");
+			json->obj_add_str("method", method_str(method));
+			if (params) {json->obj_add_obj("params", *params);}
+			return json;
+		}
 	};
 
 	struct cancel_params {
@@ -249,8 +296,16 @@ namespace hill::lsp::models {
 	};
 
 	struct progress_params {
-		int token;
+		std::shared_ptr<::hill::utils::json_value> token; // Integer or string
 		std::shared_ptr<::hill::utils::json_value> value;
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_obj("token", token);
+			json->obj_add_obj("value", value);
+			return json;
+		}
 	};
 
 	struct position {
@@ -753,7 +808,28 @@ namespace hill::lsp::models {
 		std::optional<std::vector<diagnostic_related_information>> related_information = {};
 		std::optional<std::shared_ptr<::hill::utils::json_value>> data = {};
 
-		// TODO: parsing and serializing
+		// TODO: parsing
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_obj("range", range.json());
+			if (severity) {json->obj_add_num("severity", (double)*severity);}
+			if (code) {json->obj_add_num("code", (double)*code);}
+			if (code_description) {json->obj_add_obj("codeDescription", code_description->json());}
+			if (source) {json->obj_add_str("source", *source);}
+			json->obj_add_str("message", message);
+			if (tags) {
+				auto arr = *json->obj_add_arr("tags");
+				for (auto tag : *tags) arr->arr_add_num((double)tag);
+			}
+			if (related_information) {
+				auto arr = *json->obj_add_arr("relatedInformation");
+				for (const auto &info : *related_information) arr->arr_add_obj(info.json());
+			}
+			if (data) {json->obj_add_obj("data", *data);}
+			return json;
+		}
 	};
 
 	struct command {
@@ -1120,9 +1196,23 @@ namespace hill::lsp::models {
 	};
 
 	struct partial_result_params {
-		std::optional<int> partial_result_token = {}; // int or string?
+		std::optional<std::shared_ptr<utils::json_value>> partial_result_token = {}; // Integer or string
 
-		// TODO: parsing and serializing
+		static std::optional<partial_result_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			std::optional<std::shared_ptr<json_value>> partial_result_token = {};
+			if (json->obj_has("partialResultToken")) {
+				auto token_json = *json->obj_get("partialResultToken");
+				if (token_json->kind()!=json_value_kind::NUMBER && token_json->kind()!=json_value_kind::STRING) return {};
+				partial_result_token = token_json;
+			}
+
+			return partial_result_params{.partial_result_token = partial_result_token};
+		}
 	};
 
 	enum class trace_value {
@@ -1176,7 +1266,45 @@ namespace hill::lsp::models {
 		std::optional<trace_value> trace = {};
 		std::optional<std::vector<workspace_folder>> workspace_folders = {}; // workspace_folder[] or null
 
-		// TODO: parsing and serializing
+		// TODO: Parse the remaining fields and serializing
+
+		static std::optional<initialize_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			initialize_params params;
+
+			if (json->obj_has("rootPath")) {
+				auto root_path = *json->obj_get("rootPath");
+				if (root_path->kind()==json_value_kind::STRING) params.root_path = *root_path->str();
+			}
+
+			if (json->obj_has("rootUri")) {
+				auto root_uri = *json->obj_get("rootUri");
+				if (root_uri->kind()==json_value_kind::STRING) params.root_uri = *root_uri->str();
+			}
+
+			if (json->obj_has("initializationOptions")) {
+				params.initialization_options = *json->obj_get("initializationOptions");
+			}
+
+			if (json->obj_has("workspaceFolders")) {
+				auto folders_json = *json->obj_get("workspaceFolders");
+				if (folders_json->kind()==json_value_kind::ARRAY) {
+					std::vector<workspace_folder> folders;
+					for (const auto &el : *folders_json->arr()) {
+						auto folder = workspace_folder::from_json(el);
+						if (!folder) return {};
+						folders.push_back(*folder);
+					}
+					params.workspace_folders = folders;
+				}
+			}
+
+			return params;
+		}
 
 		/*static std::optional<work_done_progress_params> from_json(const std::shared_ptr<utils::json_value> &json)
 		{
@@ -1346,13 +1474,65 @@ namespace hill::lsp::models {
 		}
 	};
 
+	struct semantic_tokens_legend {
+		std::vector<std::string> token_types;
+		std::vector<std::string> token_modifiers;
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			auto token_types_arr = *json->obj_add_arr("tokenTypes");
+			for (const auto &token_type : token_types) {token_types_arr->arr_add_str(token_type);}
+			auto token_modifiers_arr = *json->obj_add_arr("tokenModifiers");
+			for (const auto &token_modifier : token_modifiers) {token_modifiers_arr->arr_add_str(token_modifier);}
+			return json;
+		}
+	};
+
+	struct semantic_tokens_options {
+		semantic_tokens_legend legend;
+		bool range = false;
+		bool full_delta = false;
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_obj("legend", legend.json());
+			json->obj_add_bool("range", range);
+			auto full = *json->obj_add_obj("full");
+			full->obj_add_bool("delta", full_delta);
+			return json;
+		}
+	};
+
+	struct diagnostic_options {
+		std::optional<std::string> identifier = {};
+		bool inter_file_dependencies = false;
+		bool workspace_diagnostics = false;
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			if (identifier) {json->obj_add_str("identifier", *identifier);}
+			json->obj_add_bool("interFileDependencies", inter_file_dependencies);
+			json->obj_add_bool("workspaceDiagnostics", workspace_diagnostics);
+			return json;
+		}
+	};
+
 	struct server_capabilities {
 		std::optional<position_encoding_kind> position_encoding = {};
 		std::optional<text_document_sync_kind> text_document_sync = {};
 		std::optional<completion_options> completion_provider = {};
 		//std::optional<std::variant<bool, hover_options>> hover_provider = {};
 		std::optional<bool> hover_provider = {};
+		std::optional<bool> definition_provider = {};
+		std::optional<bool> references_provider = {};
 		std::optional<bool> document_formatting_provider = {};
+		std::optional<semantic_tokens_options> semantic_tokens_provider = {};
+		std::optional<bool> workspace_symbol_provider = {};
+		std::optional<bool> inlay_hint_provider = {};
+		std::optional<diagnostic_options> diagnostic_provider = {};
 
 		std::shared_ptr<utils::json_value> json() const
 		{
@@ -1361,7 +1541,13 @@ namespace hill::lsp::models {
 			if (text_document_sync) {json->obj_add_num("textDocumentSync", (double)*text_document_sync);}
 			if (completion_provider) {json->obj_add_obj("completionProvider", (*completion_provider).json());}
 			if (hover_provider) {json->obj_add_bool("hoverProvider", *hover_provider);}
+			if (definition_provider) {json->obj_add_bool("definitionProvider", *definition_provider);}
+			if (references_provider) {json->obj_add_bool("referencesProvider", *references_provider);}
 			if (document_formatting_provider) {json->obj_add_bool("documentFormattingProvider", *document_formatting_provider);}
+			if (semantic_tokens_provider) {json->obj_add_obj("semanticTokensProvider", (*semantic_tokens_provider).json());}
+			if (workspace_symbol_provider) {json->obj_add_bool("workspaceSymbolProvider", *workspace_symbol_provider);}
+			if (inlay_hint_provider) {json->obj_add_bool("inlayHintProvider", *inlay_hint_provider);}
+			if (diagnostic_provider) {json->obj_add_obj("diagnosticProvider", (*diagnostic_provider).json());}
 			return json;
 		}
 	};
@@ -1775,11 +1961,96 @@ namespace hill::lsp::models {
 		}
 	};
 
-	/*struct text_document_content_change_event {
-#if 0
-		range: Range;
-#endif
-		std::optional<uint32_t> range_length = {}; // rangeLength
+	struct semantic_tokens_params {
+		text_document_identifier text_document;
+
+		static std::optional<semantic_tokens_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+			if (!json->obj_has("textDocument")) return {};
+			auto text_document = text_document_identifier::from_json(*json->obj_get("textDocument"));
+			if (!text_document) return {};
+
+			return semantic_tokens_params{.text_document = *text_document};
+		}
+	};
+
+	struct semantic_tokens_delta_params {
+		text_document_identifier text_document;
+		std::string previous_result_id;
+
+		static std::optional<semantic_tokens_delta_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+			if (!json->obj_has("textDocument")) return {};
+			auto text_document = text_document_identifier::from_json(*json->obj_get("textDocument"));
+			if (!text_document) return {};
+
+			if (!json->obj_has("previousResultId")) return {};
+			auto previous_result_id_json = *json->obj_get("previousResultId");
+			if (previous_result_id_json->kind()!=json_value_kind::STRING) return {};
+
+			return semantic_tokens_delta_params{
+				.text_document = *text_document,
+				.previous_result_id = *previous_result_id_json->str(),
+			};
+		}
+	};
+
+	struct semantic_tokens {
+		std::optional<std::string> result_id = {};
+		std::vector<uint32_t> data;
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			if (result_id) {json->obj_add_str("resultId", *result_id);}
+			auto data_arr = *json->obj_add_arr("data");
+			for (auto val : data) {data_arr->arr_add_num((double)val);}
+			return json;
+		}
+	};
+
+	struct semantic_tokens_edit {
+		uint32_t start;
+		uint32_t delete_count;
+		std::vector<uint32_t> data;
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_num("start", (double)start);
+			json->obj_add_num("deleteCount", (double)delete_count);
+			auto data_arr = *json->obj_add_arr("data");
+			for (auto val : data) {data_arr->arr_add_num((double)val);}
+			return json;
+		}
+	};
+
+	struct semantic_tokens_delta {
+		std::optional<std::string> result_id = {};
+		std::vector<semantic_tokens_edit> edits;
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			if (result_id) {json->obj_add_str("resultId", *result_id);}
+			auto edits_arr = *json->obj_add_arr("edits");
+			for (const auto &edit : edits) {edits_arr->arr_add_obj(edit.json());}
+			return json;
+		}
+	};
+
+	/**
+	 * A change of a range, or of the whole document without a range
+	 */
+	struct text_document_content_change_event {
+		std::optional<models::range> range = {};
+		std::optional<uint32_t> range_length = {}; // Deprecated by the protocol
 		std::string text;
 
 		static std::optional<text_document_content_change_event> from_json(const std::shared_ptr<utils::json_value> &json)
@@ -1787,16 +2058,40 @@ namespace hill::lsp::models {
 			using namespace ::hill::utils;
 
 			if (json->kind()!=json_value_kind::OBJECT) return {};
-			
-			return text_document_content_change_event{};
+
+			std::optional<models::range> range = {};
+			if (json->obj_has("range")) {
+				range = models::range::from_json(*json->obj_get("range"));
+				if (!range) return {};
+			}
+
+			std::optional<uint32_t> range_length = {};
+			if (json->obj_has("rangeLength")) {
+				auto range_length_json = *json->obj_get("rangeLength");
+				if (range_length_json->kind()!=json_value_kind::NUMBER) return {};
+				range_length = (uint32_t)*range_length_json->num();
+			}
+
+			if (!json->obj_has("text")) return {};
+			auto text_json = *json->obj_get("text");
+			if (text_json->kind()!=json_value_kind::STRING) return {};
+
+			return text_document_content_change_event{
+				.range = range,
+				.range_length = range_length,
+				.text = *text_json->str(),
+			};
 		}
 
 		std::shared_ptr<utils::json_value> json() const
 		{
 			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			if (range) {json->obj_add_obj("range", range->json());}
+			if (range_length) {json->obj_add_num("rangeLength", (double)*range_length);}
+			json->obj_add_str("text", text);
 			return json;
 		}
-	};*/
+	};
 
 	struct text_document_content_change_all {
 		std::string text;
@@ -1825,10 +2120,7 @@ namespace hill::lsp::models {
 
 	struct did_change_text_document_params {
 		versioned_text_document_identifier text_document;
-		// TODO: Use variant
-		//std::vector<text_document_content_change_event> content_changes;
-		//std::variant<std::vector<text_document_content_change_event>, std::vector<text_document_content_change_all>> content_changes;
-		std::vector<text_document_content_change_all> content_changes;
+		std::vector<text_document_content_change_event> content_changes;
 
 		static std::optional<did_change_text_document_params> from_json(const std::shared_ptr<utils::json_value> &json)
 		{
@@ -1844,10 +2136,10 @@ namespace hill::lsp::models {
 			auto content_changes_arr_json = *json->obj_get("contentChanges");
 			if (content_changes_arr_json->kind()!=json_value_kind::ARRAY) return {};
 
-			std::vector<text_document_content_change_all> content_changes;
+			std::vector<text_document_content_change_event> content_changes;
 			auto content_changes_arr = *content_changes_arr_json->arr();
 			for (const auto &el : content_changes_arr) {
-				auto content_change = models::text_document_content_change_all::from_json(el);
+				auto content_change = models::text_document_content_change_event::from_json(el);
 				if (!content_change) return {};
 				content_changes.push_back(*content_change);
 			}
@@ -1875,6 +2167,355 @@ namespace hill::lsp::models {
 			return json;
 		}
 	};
+
+	enum class symbol_kind: int {
+		FILE = 1,
+		MODULE = 2,
+		NAMESPACE = 3,
+		PACKAGE = 4,
+		CLASS = 5,
+		METHOD = 6,
+		PROPERTY = 7,
+		FIELD = 8,
+		CONSTRUCTOR = 9,
+		ENUM = 10,
+		INTERFACE = 11,
+		FUNCTION = 12,
+		VARIABLE = 13,
+		CONSTANT = 14,
+		STRING = 15,
+		NUMBER = 16,
+		BOOLEAN = 17,
+		ARRAY = 18,
+		OBJECT = 19,
+		KEY = 20,
+		NULL_ = 21,
+		ENUM_MEMBER = 22,
+		STRUCT = 23,
+		EVENT = 24,
+		OPERATOR = 25,
+		TYPE_PARAMETER = 26,
+	};
+
+	struct symbol_information {
+		std::string name;
+		symbol_kind kind;
+		models::location location;
+		std::optional<std::string> container_name = {};
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_str("name", name);
+			json->obj_add_num("kind", (double)kind);
+			json->obj_add_obj("location", location.json());
+			if (container_name) {json->obj_add_str("containerName", *container_name);}
+			return json;
+		}
+	};
+
+	// Extends work_done_progress_params, partial_result_params
+	struct workspace_symbol_params {
+		std::string query;
+
+		static std::optional<workspace_symbol_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			if (!json->obj_has("query")) return {};
+			auto query = *json->obj_get("query");
+			if (query->kind()!=json_value_kind::STRING) return {};
+
+			return workspace_symbol_params{
+				.query = *query->str(),
+			};
+		}
+	};
+
+	// Extends text_document_position_params
+	struct reference_params {
+		text_document_identifier text_document;
+		models::position position;
+		bool include_declaration;
+
+		static std::optional<reference_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			auto pos_params = text_document_position_params::from_json(json);
+			if (!pos_params) return {};
+
+			if (!json->obj_has("context")) return {};
+			auto context = *json->obj_get("context");
+			if (context->kind()!=json_value_kind::OBJECT) return {};
+			if (!context->obj_has("includeDeclaration")) return {};
+			auto include_declaration = *context->obj_get("includeDeclaration");
+			if (include_declaration->kind()!=json_value_kind::BOOL) return {};
+
+			return reference_params{
+				.text_document = (*pos_params).text_document,
+				.position = (*pos_params).position,
+				.include_declaration = *include_declaration->boolean(),
+			};
+		}
+	};
+
+	enum class file_change_type: int {
+		CREATED = 1,
+		CHANGED = 2,
+		DELETED = 3,
+	};
+
+	struct file_event {
+		std::string uri;
+		file_change_type type;
+
+		static std::optional<file_event> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			if (!json->obj_has("uri")) return {};
+			auto uri = *json->obj_get("uri");
+			if (uri->kind()!=json_value_kind::STRING) return {};
+
+			if (!json->obj_has("type")) return {};
+			auto type = *json->obj_get("type");
+			if (type->kind()!=json_value_kind::NUMBER) return {};
+
+			return file_event{
+				.uri = *uri->str(),
+				.type = (file_change_type)(int)*type->num(),
+			};
+		}
+	};
+
+	struct did_change_watched_files_params {
+		std::vector<file_event> changes;
+
+		static std::optional<did_change_watched_files_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			if (!json->obj_has("changes")) return {};
+			auto changes_json = *json->obj_get("changes");
+			if (changes_json->kind()!=json_value_kind::ARRAY) return {};
+
+			std::vector<file_event> changes;
+			for (const auto &el : *changes_json->arr()) {
+				auto change = file_event::from_json(el);
+				if (!change) return {};
+				changes.push_back(*change);
+			}
+
+			return did_change_watched_files_params{
+				.changes = changes,
+			};
+		}
+	};
+
+	// Extends work_done_progress_params
+	struct inlay_hint_params {
+		text_document_identifier text_document;
+		models::range range;
+
+		static std::optional<inlay_hint_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			if (!json->obj_has("textDocument")) return {};
+			auto text_document = text_document_identifier::from_json(*json->obj_get("textDocument"));
+			if (!text_document) return {};
+
+			if (!json->obj_has("range")) return {};
+			auto range = models::range::from_json(*json->obj_get("range"));
+			if (!range) return {};
+
+			return inlay_hint_params{
+				.text_document = *text_document,
+				.range = *range,
+			};
+		}
+	};
+
+	enum class inlay_hint_kind: int {
+		TYPE = 1,
+		PARAMETER = 2,
+	};
+
+	struct inlay_hint {
+		models::position position;
+		std::string label; // TODO: InlayHintLabelPart[]
+		std::optional<inlay_hint_kind> kind = {};
+		std::optional<bool> padding_left = {};
+		std::optional<bool> padding_right = {};
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_obj("position", position.json());
+			json->obj_add_str("label", label);
+			if (kind) {json->obj_add_num("kind", (double)*kind);}
+			if (padding_left) {json->obj_add_bool("paddingLeft", *padding_left);}
+			if (padding_right) {json->obj_add_bool("paddingRight", *padding_right);}
+			return json;
+		}
+	};
+
+	// Extends work_done_progress_params, partial_result_params
+	struct document_diagnostic_params {
+		text_document_identifier text_document;
+		std::optional<std::string> identifier = {};
+		std::optional<std::string> previous_result_id = {};
+
+		static std::optional<document_diagnostic_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			if (!json->obj_has("textDocument")) return {};
+			auto text_document = text_document_identifier::from_json(*json->obj_get("textDocument"));
+			if (!text_document) return {};
+
+			std::optional<std::string> identifier = {};
+			if (json->obj_has("identifier")) {
+				auto identifier_json = *json->obj_get("identifier");
+				if (identifier_json->kind()!=json_value_kind::STRING) return {};
+				identifier = *identifier_json->str();
+			}
+
+			std::optional<std::string> previous_result_id = {};
+			if (json->obj_has("previousResultId")) {
+				auto previous_json = *json->obj_get("previousResultId");
+				if (previous_json->kind()!=json_value_kind::STRING) return {};
+				previous_result_id = *previous_json->str();
+			}
+
+			return document_diagnostic_params{
+				.text_document = *text_document,
+				.identifier = identifier,
+				.previous_result_id = previous_result_id,
+			};
+		}
+	};
+
+	struct previous_result_id {
+		std::string uri;
+		std::string value;
+
+		static std::optional<previous_result_id> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			if (!json->obj_has("uri")) return {};
+			auto uri = *json->obj_get("uri");
+			if (uri->kind()!=json_value_kind::STRING) return {};
+
+			if (!json->obj_has("value")) return {};
+			auto value = *json->obj_get("value");
+			if (value->kind()!=json_value_kind::STRING) return {};
+
+			return previous_result_id{.uri = *uri->str(), .value = *value->str()};
+		}
+	};
+
+	// Extends work_done_progress_params
+	struct workspace_diagnostic_params {
+		std::optional<std::string> identifier = {};
+		std::vector<previous_result_id> previous_result_ids;
+		// partial_result_params
+		std::optional<std::shared_ptr<utils::json_value>> partial_result_token = {};
+
+		static std::optional<workspace_diagnostic_params> from_json(const std::shared_ptr<utils::json_value> &json)
+		{
+			using namespace ::hill::utils;
+
+			if (json->kind()!=json_value_kind::OBJECT) return {};
+
+			std::optional<std::string> identifier = {};
+			if (json->obj_has("identifier")) {
+				auto identifier_json = *json->obj_get("identifier");
+				if (identifier_json->kind()!=json_value_kind::STRING) return {};
+				identifier = *identifier_json->str();
+			}
+
+			if (!json->obj_has("previousResultIds")) return {};
+			auto previous_json = *json->obj_get("previousResultIds");
+			if (previous_json->kind()!=json_value_kind::ARRAY) return {};
+
+			std::vector<previous_result_id> previous_result_ids;
+			auto previous_arr = *previous_json->arr();
+			for (const auto &item : previous_arr) {
+				auto previous = previous_result_id::from_json(item);
+				if (!previous) return {};
+				previous_result_ids.push_back(*previous);
+			}
+
+			auto partial_result = partial_result_params::from_json(json);
+			if (!partial_result) return {};
+
+			return workspace_diagnostic_params{
+				.identifier = identifier,
+				.previous_result_ids = previous_result_ids,
+				.partial_result_token = partial_result->partial_result_token,
+			};
+		}
+	};
+
+	enum class document_diagnostic_report_kind {
+		FULL,
+		UNCHANGED,
+	};
+
+	constexpr const char *document_diagnostic_report_kind_str(document_diagnostic_report_kind kind)
+	{
+		// This string is used as part of the protocl
+		// and is therefor case sensitive.
+		switch (kind) {
+		case document_diagnostic_report_kind::FULL: return "full";
+		case document_diagnostic_report_kind::UNCHANGED: return "unchanged";
+		default: throw internal_exception();
+		}
+	}
+
+	/**
+	 * Full or unchanged report, an unchanged report has no items.
+	 * With a uri it is a report of a workspace document, a version is only known for open documents.
+	 */
+	struct document_diagnostic_report {
+		document_diagnostic_report_kind kind;
+		std::optional<std::string> result_id = {};
+		std::vector<diagnostic> items = {};
+		std::optional<std::string> uri = {};
+		std::optional<int> version = {};
+
+		std::shared_ptr<utils::json_value> json() const
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_str("kind", document_diagnostic_report_kind_str(kind));
+			if (result_id) {json->obj_add_str("resultId", *result_id);}
+			if (kind==document_diagnostic_report_kind::FULL) {
+				auto arr = *json->obj_add_arr("items");
+				for (const auto &item : items) arr->arr_add_obj(item.json());
+			}
+			if (uri) {
+				json->obj_add_str("uri", *uri);
+				if (version) json->obj_add_num("version", (double)*version);
+				else json->obj_add_obj("version", utils::json_value::create<utils::json_value_kind::JSON_NULL>());
+			}
+			return json;
+		}
+	};
 };
 
 #endif /* HILL__LSP__MODELS_HH_INCLUDED */
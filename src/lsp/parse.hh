@@ -0,0 +1,188 @@
+#ifndef HILL__LSP__PARSE_HH_INCLUDED
+#define HILL__LSP__PARSE_HH_INCLUDED
+
+#include "document_store.hh"
+#include "../exceptions.hh"
+#include "../parser.hh"
+#include "../token.hh"
+#include "../utils/cancellation_token.hh"
+
+#include <algorithm>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hill::lsp {
+
+	/**
+	 * Parsed tokens of one document version, kept per top-level statement.
+	 * A top-level ';' leaves the parser with an empty operator stack, so each statement parses on its own
+	 * and the rpn of the document is the rpn of its statements one after the other.
+	 * After an edit only the statements touching the changed tokens are parsed again.
+	 */
+	struct document_parse {
+		static constexpr const char *ARTIFACT = "parse";
+
+		struct statement {
+			size_t token_begin, token_end; // In the document tokens, the last statement includes END
+			size_t rpn_begin, rpn_end;
+		};
+
+		std::vector<token> rpn;
+		std::vector<statement> statements; // Up to the first syntax error
+
+		std::optional<error_code> error = {};
+		std::string error_message;
+		int error_lix = -1, error_cix = -1;
+
+		size_t reparsed = 0; // Statements parsed for this version, the others were reused
+
+		size_t approx_bytes() const
+		{
+			return sizeof *this + lsp::approx_bytes(rpn) + statements.capacity()*sizeof(statement) + error_message.capacity();
+		}
+
+		static std::shared_ptr<const document_parse> get(const document &doc, const utils::cancellation_token &cancellation = {})
+		{
+			return doc.derived<document_parse>([&] {return build(doc, cancellation);});
+		}
+
+	private:
+		/**
+		 * Hands the parser the tokens of one statement, whitespace left out
+		 */
+		struct statement_lexer {
+			const std::vector<token> &tokens;
+			size_t ix, end;
+			int lix = -1, cix = -1; // The token being parsed, the parser reads one ahead
+			int next_lix = -1, next_cix = -1;
+
+			token get_token(std::istream &)
+			{
+				while (ix<end && tokens[ix].ws()) ++ix;
+
+				lix = next_lix;
+				cix = next_cix;
+				if (ix>=end) return token(tt::END, "", -1, -1);
+
+				next_lix = tokens[ix].lix;
+				next_cix = tokens[ix].cix;
+				return tokens[ix++].clone();
+			}
+		};
+
+		/**
+		 * End of the statement starting at begin, after its top-level ';' or past the END token
+		 */
+		static size_t statement_end(const std::vector<token> &tokens, size_t begin)
+		{
+			int depth = 0;
+			for (size_t ix=begin; ix+1<tokens.size(); ++ix) {
+				if (tokens[ix].lgroup()) ++depth;
+				else if (tokens[ix].rgroup() && depth>0) --depth;
+				else if (depth==0 && tokens[ix].get_type()==tt::OP_SEMICOLON) return ix+1;
+			}
+			return tokens.size();
+		}
+
+		/**
+		 * Copy statements of the previous version, moving positions and indices past the edit
+		 */
+		static void reuse(document_parse &res, const document_parse &prev, size_t first, size_t last, const token_diff *diff)
+		{
+			for (auto six=first; six<last; ++six) {
+				const auto &st = prev.statements[six];
+				auto rpn_begin = res.rpn.size();
+				for (auto rix=st.rpn_begin; rix<st.rpn_end; ++rix) {
+					auto t = prev.rpn[rix].clone();
+					if (diff) diff->move(t.lix, t.cix);
+					res.rpn.push_back(std::move(t));
+				}
+				res.statements.push_back(statement{
+					.token_begin = diff ? st.token_begin-diff->old_suffix+diff->new_suffix : st.token_begin,
+					.token_end = diff ? st.token_end-diff->old_suffix+diff->new_suffix : st.token_end,
+					.rpn_begin = rpn_begin,
+					.rpn_end = res.rpn.size()});
+			}
+		}
+
+		static std::shared_ptr<const document_parse> build(const document &doc, const utils::cancellation_token &cancellation)
+		{
+			auto res = std::make_shared<document_parse>();
+			auto tokens_ptr = doc.tokens(cancellation);
+			const auto &tokens = *tokens_ptr;
+
+			auto prev = doc.previous<document_parse>();
+			const auto &diff = doc.get_token_diff();
+			if (!diff) prev = nullptr;
+
+			size_t tix = 0;
+			if (prev) {
+				// Statements before the first changed token are the same
+				size_t six = 0;
+				while (six<prev->statements.size() && prev->statements[six].token_end<=diff->prefix) ++six;
+				reuse(*res, *prev, 0, six, nullptr);
+				if (six) tix = prev->statements[six-1].token_end;
+			}
+
+			while (tix<tokens.size()) {
+				cancellation.throw_if_cancelled();
+
+				if (prev && tix>=diff->new_suffix) {
+					// Past the edit, a statement starting where one started before is the same
+					auto old_tix = tix-diff->new_suffix+diff->old_suffix;
+					auto it = std::lower_bound(prev->statements.begin(), prev->statements.end(), old_tix,
+						[](const statement &st, size_t ix) {return st.token_begin<ix;});
+					if (it!=prev->statements.end() && it->token_begin==old_tix) {
+						reuse(*res, *prev, (size_t)(it-prev->statements.begin()), prev->statements.size(), &*diff);
+						tix = res->statements.back().token_end;
+						continue;
+					}
+				}
+
+				auto end = statement_end(tokens, tix);
+				auto is_last = end==tokens.size();
+
+				hill::parser parser;
+				statement_lexer lexer{.tokens = tokens, .ix = tix, .end = is_last ? tokens.size()-1 : end};
+				std::istream unused(nullptr);
+
+				auto fail = [&](error_code code, const char *message) {
+					res->error = code;
+					res->error_message = message;
+					// At the start of the statement if it failed before reading a token
+					res->error_lix = lexer.lix>=0 ? lexer.lix : tokens[tix].lix;
+					res->error_cix = lexer.lix>=0 ? lexer.cix : tokens[tix].cix;
+				};
+
+				try {
+					parser.parse(unused, lexer, cancellation);
+				} catch (const cancelled_exception &) {
+					throw;
+				} catch (const hill::exception &e) {
+					fail(e.get_error_code(), e.what());
+					break;
+				} catch (const std::exception &e) {
+					fail((error_code)-1, e.what());
+					break;
+				}
+
+				// END belongs to the last statement only
+				if (!is_last) parser.rpn.pop_back();
+
+				auto rpn_begin = res->rpn.size();
+				for (auto &t : parser.rpn) res->rpn.push_back(std::move(t));
+				res->statements.push_back(statement{.token_begin = tix, .token_end = end, .rpn_begin = rpn_begin, .rpn_end = res->rpn.size()});
+				++res->reparsed;
+				tix = end;
+			}
+
+			return res;
+		}
+	};
+}
+
+#endif /* HILL__LSP__PARSE_HH_INCLUDED */
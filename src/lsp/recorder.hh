@@ -0,0 +1,108 @@
+#ifndef HILL__LSP__RECORDER_HH_INCLUDED
+#define HILL__LSP__RECORDER_HH_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hill::lsp {
+
+	/**
+	 * Records incoming messages for offline replay.
+	 *
+	 * A recording uses the same framing as the protocol with an extra header
+	 * holding the time in microseconds since the first message:
+	 *
+	 *   Content-Length: 52\r\n
+	 *   X-Hill-Time-Us: 1503\r\n
+	 *   \r\n
+	 *   {"jsonrpc":"2.0","method":"initialized","params":{}}
+	 */
+	struct recorder {
+		struct entry {
+			uint64_t time_us;
+			std::string content;
+		};
+
+		static bool open(const std::filesystem::path &fpath)
+		{
+			auto &r = get();
+			if (fpath.has_parent_path()) std::filesystem::create_directories(fpath.parent_path());
+			r.ofs.open(fpath, std::ios::binary);
+			return r.ofs.is_open();
+		}
+
+		static bool enabled() {return get().ofs.is_open();}
+
+		/**
+		 * Only called from the receiving thread
+		 */
+		static void record(const std::string &content)
+		{
+			auto &r = get();
+			if (!r.ofs.is_open()) return;
+
+			auto now = std::chrono::steady_clock::now();
+			if (!r.start) r.start = now;
+			auto time_us = std::chrono::duration_cast<std::chrono::microseconds>(now - *r.start).count();
+
+			r.ofs << "Content-Length: " << content.size() << "\r\n"
+				<< "X-Hill-Time-Us: " << time_us << "\r\n\r\n";
+			r.ofs.write(content.c_str(), (std::streamsize)content.size());
+			r.ofs.flush(); // Keep the recording usable if the server crashes
+		}
+
+		static void close() {get().ofs.close();}
+
+		static std::optional<std::vector<entry>> load(const std::filesystem::path &fpath)
+		{
+			std::ifstream ifs(fpath, std::ios::binary);
+			if (!ifs) return {};
+
+			std::vector<entry> entries;
+			while (ifs.peek()!=std::char_traits<char>::eof()) {
+				std::optional<size_t> content_len;
+				uint64_t time_us = entries.empty() ? 0 : entries.back().time_us;
+
+				std::string line;
+				while (std::getline(ifs, line)) {
+					if (!line.empty() && line.back()=='\r') line.pop_back();
+					if (line.empty()) break;
+
+					auto sep = line.find(':');
+					if (sep==std::string::npos) return {};
+					auto key = line.substr(0, sep);
+					auto val = line.substr(sep+1);
+					if (key=="Content-Length") content_len = std::stoull(val);
+					else if (key=="X-Hill-Time-Us") time_us = std::stoull(val);
+				}
+				if (!content_len) return {};
+
+				std::string content(*content_len, '\0');
+				if (!ifs.read(content.data(), (std::streamsize)*content_len)) return {};
+				entries.push_back(entry{.time_us = time_us, .content = std::move(content)});
+			}
+
+			return entries;
+		}
+
+	private:
+		static recorder &get()
+		{
+			static recorder r;
+			return r;
+		}
+
+	private:
+		std::ofstream ofs;
+		std::optional<std::chrono::steady_clock::time_point> start;
+	};
+}
+
+#endif /* HILL__LSP__RECORDER_HH_INCLUDED */
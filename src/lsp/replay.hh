@@ -0,0 +1,300 @@
+#ifndef HILL__LSP__REPLAY_HH_INCLUDED
+#define HILL__LSP__REPLAY_HH_INCLUDED
+
+#include "recorder.hh"
+#include "../utils/histogram.hh"
+#include "../utils/json_parser.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace hill::lsp {
+
+	/**
+	 * Feeds a recording to a language server child process over a pipe and
+	 * reports throughput, per method latency and the peak memory of the server.
+	 */
+	struct replay {
+		struct options {
+			std::filesystem::path recording;
+			std::string server_path;
+			bool max_speed = false;
+		};
+
+		static bool run(const options &opts, std::ostream &out)
+		{
+#ifdef _WIN32
+			(void)opts; // Unused
+			out << "lsp-replay is not supported on Windows\n";
+			return false;
+#else
+			auto entries = recorder::load(opts.recording);
+			if (!entries) {
+				out << "Failed to load recording " << opts.recording << '\n';
+				return false;
+			}
+
+			std::vector<message> messages;
+			for (auto &e : *entries) messages.push_back(message::parse(std::move(e)));
+
+			int to_server[2], from_server[2];
+			if (pipe(to_server) || pipe(from_server)) {
+				out << "Failed to create pipes\n";
+				return false;
+			}
+
+			auto pid = fork();
+			if (pid<0) {
+				out << "Failed to start server\n";
+				return false;
+			}
+			if (pid==0) {
+				dup2(to_server[0], STDIN_FILENO);
+				dup2(from_server[1], STDOUT_FILENO);
+				::close(to_server[0]); ::close(to_server[1]);
+				::close(from_server[0]); ::close(from_server[1]);
+				execl(opts.server_path.c_str(), opts.server_path.c_str(), "lsp", (char *)nullptr);
+				_exit(127);
+			}
+
+			::close(to_server[0]);
+			::close(from_server[1]);
+			signal(SIGPIPE, SIG_IGN); // A crashing server should end the replay, not the driver
+
+			session s;
+			auto start = std::chrono::steady_clock::now();
+			std::thread sender(&replay::send_loop, std::ref(s), std::cref(messages), opts.max_speed, to_server[1]);
+
+			FILE *in = fdopen(from_server[0], "rb");
+			while (auto content = read_frame(in)) {
+				s.on_response(*content);
+			}
+			fclose(in);
+			s.on_server_gone();
+
+			sender.join();
+			auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			int status = 0;
+			rusage usage = {};
+			wait4(pid, &status, 0, &usage);
+
+			report(s, messages.size(), duration, usage.ru_maxrss, out);
+			return WIFEXITED(status) && WEXITSTATUS(status)==0;
+#endif
+		}
+
+	private:
+		struct message {
+			recorder::entry entry;
+			std::optional<int> id;
+			std::string method;
+
+			static message parse(recorder::entry &&entry)
+			{
+				message msg = {.entry = std::move(entry), .id = {}, .method = {}};
+
+				std::istringstream istr(msg.entry.content);
+				auto json = utils::json_parser::parse(istr);
+				if (!json || (*json)->kind()!=utils::json_value_kind::OBJECT) return msg;
+
+				auto method = (*json)->obj_get("method");
+				if (method && (*method)->str()) msg.method = *(*method)->str();
+				auto id = (*json)->obj_get("id");
+				if (id && (*id)->num()) msg.id = (int)*(*id)->num();
+
+				return msg;
+			}
+		};
+
+		struct pending_request {
+			std::string method;
+			std::chrono::steady_clock::time_point sent;
+		};
+
+		struct session {
+			std::mutex mutex;
+			std::condition_variable cond;
+			std::map<int, pending_request> pending;
+			std::map<std::string, std::unique_ptr<utils::histogram>> latency; // Microseconds per method
+			size_t requests = 0;
+			size_t responses = 0;
+			bool server_gone = false;
+
+			void on_send(int id, const std::string &method)
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				pending[id] = pending_request{.method = method, .sent = std::chrono::steady_clock::now()};
+				++requests;
+			}
+
+			void on_response(const std::string &content)
+			{
+				auto now = std::chrono::steady_clock::now();
+
+				std::istringstream istr(content);
+				auto json = utils::json_parser::parse(istr);
+				if (!json || (*json)->kind()!=utils::json_value_kind::OBJECT) return;
+				if ((*json)->obj_has("method")) return; // Server initiated message
+				auto id = (*json)->obj_get("id");
+				if (!id || !(*id)->num()) return;
+
+				std::lock_guard<std::mutex> guard(mutex);
+				auto it = pending.find((int)*(*id)->num());
+				if (it==pending.end()) return;
+
+				auto &h = latency[it->second.method];
+				if (!h) h = std::make_unique<utils::histogram>();
+				h->record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - it->second.sent).count());
+
+				pending.erase(it);
+				++responses;
+				cond.notify_all();
+			}
+
+			void on_server_gone()
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				server_gone = true;
+				cond.notify_all();
+			}
+
+			/**
+			 * Clients wait for the shutdown response before exit, so the server gets to answer everything
+			 */
+			void wait_for_responses()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cond.wait_for(lock, std::chrono::seconds(30), [this] {return pending.empty() || server_gone;});
+			}
+		};
+
+#ifndef _WIN32
+		static void send_loop(session &s, const std::vector<message> &messages, bool max_speed, int fd)
+		{
+			auto start = std::chrono::steady_clock::now();
+			int max_id = 0;
+			bool exit_sent = false;
+
+			for (const auto &msg : messages) {
+				if (!max_speed) std::this_thread::sleep_until(start + std::chrono::microseconds(msg.entry.time_us));
+
+				if (msg.method=="exit") {
+					s.wait_for_responses();
+					exit_sent = true;
+				}
+				if (msg.id) {
+					max_id = std::max(max_id, *msg.id);
+					if (!msg.method.empty()) s.on_send(*msg.id, msg.method);
+				}
+				if (!write_frame(fd, msg.entry.content)) break;
+			}
+
+			// Recordings cut short still end with a clean shutdown
+			if (!exit_sent) {
+				s.wait_for_responses();
+				s.on_send(max_id+1, "shutdown");
+				write_frame(fd, R"({"jsonrpc":"2.0","id":)" + std::to_string(max_id+1) + R"(,"method":"shutdown"})");
+				s.wait_for_responses();
+				write_frame(fd, R"({"jsonrpc":"2.0","method":"exit"})");
+			}
+
+			::close(fd);
+		}
+
+		static bool write_frame(int fd, const std::string &content)
+		{
+			auto frame = "Content-Length: " + std::to_string(content.size()) + "\r\n\r\n" + content;
+
+			size_t done = 0;
+			while (done<frame.size()) {
+				auto written = ::write(fd, frame.c_str()+done, frame.size()-done);
+				if (written<0) {
+					if (errno==EINTR) continue;
+					return false;
+				}
+				done += (size_t)written;
+			}
+			return true;
+		}
+#endif
+
+		static std::optional<std::string> read_frame(FILE *in)
+		{
+			std::optional<size_t> content_len;
+			char b[512];
+
+			while (true) {
+				if (!fgets(b, sizeof(b), in)) return {};
+
+				std::string line(b);
+				while (!line.empty() && (line.back()=='\n' || line.back()=='\r')) line.pop_back();
+				if (line.empty()) break;
+
+				auto sep = line.find(':');
+				if (sep!=std::string::npos && line.substr(0, sep)=="Content-Length") {
+					content_len = std::stoull(line.substr(sep+1));
+				}
+			}
+			if (!content_len) return {};
+
+			std::string content(*content_len, '\0');
+			if (fread(content.data(), 1, *content_len, in)!=*content_len) return {};
+			return content;
+		}
+
+		static void report(session &s, size_t message_cnt, double duration, long peak_rss_kb, std::ostream &out)
+		{
+			std::lock_guard<std::mutex> guard(s.mutex);
+
+			out << "Replayed " << message_cnt << " messages (" << s.requests << " requests) in "
+				<< std::fixed << std::setprecision(3) << duration << " s, "
+				<< std::setprecision(1) << (duration>0.0 ? (double)message_cnt / duration : 0.0) << " msg/s\n";
+			if (s.responses!=s.requests) {
+				out << "Unanswered requests: " << (s.requests - s.responses) << '\n';
+			}
+			out << "Peak server RSS: " << peak_rss_kb << " KB\n";
+
+			out << '\n' << std::left << std::setw(32) << "method" << std::right
+				<< std::setw(8) << "count"
+				<< std::setw(10) << "p50 us"
+				<< std::setw(10) << "p90 us"
+				<< std::setw(10) << "p99 us"
+				<< std::setw(10) << "max us" << '\n';
+			for (const auto &[method, h] : s.latency) {
+				out << std::left << std::setw(32) << method << std::right
+					<< std::setw(8) << h->count()
+					<< std::setw(10) << h->percentile(50.0)
+					<< std::setw(10) << h->percentile(90.0)
+					<< std::setw(10) << h->percentile(99.0)
+					<< std::setw(10) << h->max() << '\n';
+			}
+		}
+	};
+}
+
+#endif /* HILL__LSP__REPLAY_HH_INCLUDED */
@@ -4,55 +4,97 @@
 #include "models.hh"
 #include "router.hh"
 #include "logger.hh"
+#include "scheduler.hh"
+#include "stats.hh"
+#include "writer.hh"
+#include "../exceptions.hh"
+#include "../utils/cancellation_token.hh"
 #include "../utils/json.hh"
 
+#include <chrono>
+#include <exception>
+#include <functional>
 #include <memory>
-#include <stdio.h>
-#include <mutex>
+#include <optional>
+#include <string>
 
 namespace hill::lsp {
 
 	struct request_handler {
 		request_handler() = delete;
 
-		static void handle(const std::shared_ptr<utils::json_value> &json)
+		struct job {
+			std::optional<std::string> uri; // Set for jobs ordered per document
+			document_access access;
+			std::function<void()> run;
+		};
+
+		/**
+		 * Validate a message on the receiving thread and return the job that processes it.
+		 * Cancellations are applied right away so they also reach requests that are still queued.
+		 * Messages about a document are returned with its uri so they can be ordered per document.
+		 */
+		static std::optional<job> accept(const std::shared_ptr<utils::json_value> &json)
 		{
 			using namespace ::hill::utils;
 
-			if (json->kind()!=json_value_kind::OBJECT) return;
+			if (json->kind()!=json_value_kind::OBJECT) return {};
 			if (!json->obj_has("jsonrpc") || !json->obj_has("method")) {
-				logger::error("Missing required json fields in object - " + json->stringify());
-				return;
+				logger::error([&] {return "Missing required json fields in object - " + json->stringify();});
+				return {};
 			}
 
 			auto method_json = json->obj_get("method");
-			if (!method_json || (*method_json)->kind()!=json_value_kind::STRING) return;
+			if (!method_json || (*method_json)->kind()!=json_value_kind::STRING) return {};
 			auto method_opt = models::method_parse(*(*method_json)->str());
 			if (!method_opt) {
-				logger::error("Unknown method [" + *(*method_json)->str() + "]");
-				return;
+				logger::error([&] {return "Unknown method [" + *(*method_json)->str() + "]";});
+				return {};
 			}
 			auto method = *method_opt;
+			auto received = std::chrono::steady_clock::now();
 
-			if (json->obj_has("id")) {
-				handle_request(method, json);
-			} else {
-				handle_notification(method, json);
+			if (!json->obj_has("id")) {
+				// The receive loop must see exit before it blocks on the next message
+				if (method==models::method::CANCEL_REQUEST || method==models::method::EXIT) {
+					handle_notification(method, json, received);
+					return {};
+				}
+				return job{
+					.uri = get_document_uri(json),
+					.access = get_document_access(method),
+					.run = [method, json, received] {handle_notification(method, json, received);}};
 			}
+
+			auto id_json = json->obj_get("id");
+			if (!id_json || (*id_json)->kind()!=json_value_kind::NUMBER) {
+				logger::error("Invalid request id");
+				return {};
+			}
+
+			auto id = (int)*(*id_json)->num();
+			auto cancellation = server_state::get().request_state.on_recv(id);
+
+			return job{
+				.uri = get_document_uri(json),
+				.access = get_document_access(method),
+				.run = [method, json, id, cancellation, received] {handle_request(method, json, id, cancellation, received);}};
 		}
 
 	private:
-		static std::mutex &get_response_mutex()
+		static void handle_notification(
+			models::method method,
+			const std::shared_ptr<utils::json_value> &json,
+			std::chrono::steady_clock::time_point received)
 		{
-			static std::mutex mutex;
-			return mutex;
-		}
+			auto method_str = models::method_str(method);
 
-		static void handle_notification(models::method method, const std::shared_ptr<utils::json_value> &json)
-		{
-			auto method_str = std::string(models::method_str(method));
+			auto &stats = server_stats::get().for_method(method);
+			auto started = std::chrono::steady_clock::now();
+			stats.count.fetch_add(1, std::memory_order_relaxed);
+			stats.queue_wait.record(method_stats::us_between(received, started));
 
-			logger::info("Received notify method<" + method_str + ">");
+			logger::info([&] {return "Received notify method<" + std::string(method_str) + ">";});
 
 			models::notification_message notification = {
 				.method = method,
@@ -60,28 +102,44 @@ namespace hill::lsp {
 
 			auto func = router::get_notify(method);
 			if (!func) {
-				logger::error("Fail to resolve notify method " + method_str);
+				logger::error([&] {return "Fail to resolve notify method " + std::string(method_str);});
+				stats.errors.fetch_add(1, std::memory_order_relaxed);
 				return;
 			}
 
 			(*func)(notification);
+			stats.exec.record(method_stats::us_between(started, std::chrono::steady_clock::now()));
 		}
 
-		static inline void handle_request(models::method method, const std::shared_ptr<utils::json_value> &json)
+		static inline models::response_error internal_error(const char *method_str, int id, const std::string &what)
 		{
-			using namespace ::hill::utils;
+			logger::error([&] {return "Request failed - method<" + std::string(method_str)
+				+ "> id<" + std::to_string(id)
+				+ "> what<" + what + '>';});
+			return models::response_error{.code = models::error_code::INTERNAL_ERROR, .message = what};
+		}
 
-			auto id_json = json->obj_get("id");
-			if (!id_json || (*id_json)->kind()!=json_value_kind::NUMBER) {
-				logger::error("Invalid request id");
-				return;
-			};
+		static inline void handle_request(
+			models::method method,
+			const std::shared_ptr<utils::json_value> &json,
+			int id,
+			const utils::cancellation_token &cancellation,
+			std::chrono::steady_clock::time_point received)
+		{
+			auto method_str = models::method_str(method);
 
-			auto id = (int)*(*id_json)->num();
-			auto method_str = std::string(models::method_str(method));
+			// However the request ends, its id must not stay tracked
+			struct complete_on_exit {
+				int id;
+				~complete_on_exit() {server_state::get().request_state.on_complete(id);}
+			} complete{id};
+
+			auto &stats = server_stats::get().for_method(method);
+			auto started = std::chrono::steady_clock::now();
+			stats.count.fetch_add(1, std::memory_order_relaxed);
+			stats.queue_wait.record(method_stats::us_between(received, started));
 
-			logger::info("Received method<" + method_str + "> id<" + std::to_string(id) + ">");
-			server_state::get().request_state.on_recv(id);
+			logger::info([&] {return "Received method<" + std::string(method_str) + "> id<" + std::to_string(id) + ">";});
 
 			models::request_message req = {
 				.id = id,
@@ -90,53 +148,52 @@ namespace hill::lsp {
 
 			auto func = router::get_req(method);
 			if (!func) {
-				logger::error("Fail to resolve request method " + method_str);
+				logger::error([&] {return "Fail to resolve request method " + std::string(method_str);});
+				stats.errors.fetch_add(1, std::memory_order_relaxed);
 				return;
 			}
 
-			auto result = (*func)(req);
+			router::request_result_t result;
+			try {
+				// Skip the work entirely if the request was cancelled while queued
+				cancellation.throw_if_cancelled();
+				result = (*func)(req, cancellation);
+			} catch (const cancelled_exception &) {
+			} catch (const ::hill::exception &e) {
+				// Handlers run the lexer, parser and analyzer, the client still gets an answer when they fail
+				result = internal_error(method_str, id, std::string(e.what()) + " (" + error_code_to_str(e.get_error_code()) + ')');
+			} catch (const std::exception &e) {
+				result = internal_error(method_str, id, e.what());
+			}
+			stats.exec.record(method_stats::us_between(started, std::chrono::steady_clock::now()));
+
 			models::response_message resp_msg = {.id=id};
 
-			if (server_state::get().request_state.cancelled(id)) {
+			if (cancellation.cancelled()) {
 				resp_msg.error = models::response_error{
 					.code = models::error_code::REQUEST_CANCELLED,
 					.message = "Request cancelled"};
-				logger::info("Request cancelled - method<" + method_str
+				stats.cancelled.fetch_add(1, std::memory_order_relaxed);
+				logger::info([&] {return "Request cancelled - method<" + std::string(method_str)
 					+ "> id<" + std::to_string(id)
 					+ "> code< " + std::to_string((int)(*resp_msg.error).code)
-					+ "> message<" + (*resp_msg.error).message + '>');
+					+ "> message<" + (*resp_msg.error).message + '>';});
 			} else {
 				if (std::holds_alternative<std::optional<models::result_t>>(result)) {
 					resp_msg.result = std::get<std::optional<models::result_t>>(result);
 				} else {
 					resp_msg.error = std::get<models::response_error>(result);
-					logger::info("Request error - method<" + method_str
+					stats.errors.fetch_add(1, std::memory_order_relaxed);
+					logger::info([&] {return "Request error - method<" + std::string(method_str)
 						+ "> id<" + std::to_string(id)
 						+ "> code< " + std::to_string((int)(*resp_msg.error).code)
-						+ "> message<" + (*resp_msg.error).message + '>');
+						+ "> message<" + (*resp_msg.error).message + '>';});
 				}
 			}
 
-			auto resp_msg_str = resp_msg.json()->stringify();
-
-			std::string resp_header = "Content-Length: "
-				+ std::to_string(resp_msg_str.size())
-				+ "\r\n\r\n";
-			std::stringstream ss;
-			ss.write(resp_header.c_str(), resp_header.size());
-			ss.write(resp_msg_str.c_str(), resp_msg_str.size());
-
-			auto resp = ss.str();
-
-			{
-				std::lock_guard<std::mutex> guard(get_response_mutex());
-
-				fwrite(resp.c_str(), 1, resp.size(), stdout);
-				fflush(stdout);
-			}
+			writer::send(resp_msg);
 
-			logger::info("Sent response method<" + method_str + "> id<" + std::to_string(id) + ">");
-			server_state::get().request_state.on_complete(id);
+			logger::info([&] {return "Queued response method<" + std::string(method_str) + "> id<" + std::to_string(id) + ">";});
 		}
 	};
 };
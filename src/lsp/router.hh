@@ -2,13 +2,23 @@
 #define HILL__LSP__ROUTER_HH_INCLUDED
 
 #include "models.hh"
+#include "../utils/cancellation_token.hh"
 
 #include "methods/cancel_request.hh"
 #include "methods/lifecycle.hh"
+#include "methods/memory.hh"
+#include "methods/stats.hh"
 #include "methods/text_document/completion.hh"
+#include "methods/text_document/definition.hh"
+#include "methods/text_document/diagnostic.hh"
 #include "methods/text_document/formatting.hh"
 #include "methods/text_document/hover.hh"
+#include "methods/text_document/inlay_hint.hh"
+#include "methods/text_document/references.hh"
+#include "methods/text_document/semantic_tokens.hh"
 #include "methods/text_document/synchronization.hh"
+#include "methods/workspace/diagnostic.hh"
+#include "methods/workspace/symbol.hh"
 
 #include <unordered_map>
 #include <functional>
@@ -22,7 +32,7 @@ namespace hill::lsp {
 		router() = delete;
 
 		typedef std::variant<std::optional<models::result_t>, models::response_error> request_result_t;
-		typedef std::function<request_result_t(const models::request_message &req)> request_endpoint_t;
+		typedef std::function<request_result_t(const models::request_message &req, const utils::cancellation_token &cancellation)> request_endpoint_t;
 
 		typedef std::function<void(const models::notification_message &req)> notify_endpoint_t;
 
@@ -54,7 +64,17 @@ namespace hill::lsp {
 				{models::method::SHUTDOWN, methods::shutdown},
 				{models::method::TEXT_DOCUMENT_COMPLETION, methods::text_document_completion},
 				{models::method::TEXT_DOCUMENT_HOVER, methods::text_document_hover},
+				{models::method::TEXT_DOCUMENT_DEFINITION, methods::text_document_definition},
+				{models::method::TEXT_DOCUMENT_REFERENCES, methods::text_document_references},
 				{models::method::TEXT_DOCUMENT_FORMATTING, methods::text_document_formatting},
+				{models::method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL, methods::text_document_semantic_tokens_full},
+				{models::method::TEXT_DOCUMENT_SEMANTIC_TOKENS_FULL_DELTA, methods::text_document_semantic_tokens_full_delta},
+				{models::method::TEXT_DOCUMENT_INLAY_HINT, methods::text_document_inlay_hint},
+				{models::method::TEXT_DOCUMENT_DIAGNOSTIC, methods::text_document_diagnostic},
+				{models::method::WORKSPACE_DIAGNOSTIC, methods::workspace_diagnostic},
+				{models::method::WORKSPACE_SYMBOL, methods::workspace_symbol},
+				{models::method::HILL_STATS, methods::hill_stats},
+				{models::method::HILL_MEMORY, methods::hill_memory},
 			};
 			return map;
 		}
@@ -69,6 +89,7 @@ namespace hill::lsp {
 				{models::method::TEXT_DOCUMENT_DID_OPEN, methods::text_document_did_open},
 				{models::method::TEXT_DOCUMENT_DID_CHANGE, methods::text_document_did_change},
 				{models::method::TEXT_DOCUMENT_DID_CLOSE, methods::text_document_did_close},
+				{models::method::WORKSPACE_DID_CHANGE_WATCHED_FILES, methods::workspace_did_change_watched_files},
 			};
 			return map;
 		}
@@ -0,0 +1,132 @@
+#ifndef HILL__LSP__SCHEDULER_HH_INCLUDED
+#define HILL__LSP__SCHEDULER_HH_INCLUDED
+
+#include "models.hh"
+#include "../utils/json.hh"
+#include "../utils/thread_pool.hh"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace hill::lsp {
+
+	enum class document_access {
+		READ, // May run concurrently with other reads of the same document
+		WRITE, // Runs alone, after everything received before it
+	};
+
+	inline document_access get_document_access(models::method m)
+	{
+		switch (m) {
+		case models::method::TEXT_DOCUMENT_DID_OPEN:
+		case models::method::TEXT_DOCUMENT_DID_CHANGE:
+		case models::method::TEXT_DOCUMENT_DID_CLOSE:
+		case models::method::TEXT_DOCUMENT_WILL_SAVE:
+		case models::method::TEXT_DOCUMENT_WILL_SAVE_WAIT_UNTIL:
+		case models::method::TEXT_DOCUMENT_DID_SAVE:
+			return document_access::WRITE;
+		default:
+			return document_access::READ;
+		}
+	}
+
+	/**
+	 * Get params.textDocument.uri from a message, if it has one
+	 */
+	inline std::optional<std::string> get_document_uri(const std::shared_ptr<utils::json_value> &json)
+	{
+		using namespace ::hill::utils;
+
+		auto params = json->obj_get("params");
+		if (!params || (*params)->kind()!=json_value_kind::OBJECT) return {};
+		auto text_document = (*params)->obj_get("textDocument");
+		if (!text_document || (*text_document)->kind()!=json_value_kind::OBJECT) return {};
+		auto uri = (*text_document)->obj_get("uri");
+		if (!uri || (*uri)->kind()!=json_value_kind::STRING) return {};
+		return (*uri)->str();
+	}
+
+	/**
+	 * Runs jobs in receive order per document (an actor per uri).
+	 * Different documents run in parallel on the thread pool and consecutive
+	 * reads of the same document share the snapshot left by the last write.
+	 */
+	struct document_scheduler {
+		explicit document_scheduler(utils::thread_pool &thread_pool): thread_pool(thread_pool) {}
+
+		document_scheduler(const document_scheduler &) = delete;
+		document_scheduler &operator=(const document_scheduler &) = delete;
+
+		void schedule(const std::string &uri, document_access access, const std::function<void()> &job)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			auto &l = lanes[uri];
+			l.pending.push_back({access, job});
+			pump(uri, l);
+		}
+
+	private:
+		struct lane {
+			std::deque<std::pair<document_access, std::function<void()>>> pending;
+			size_t reading = 0u;
+			bool writing = false;
+		};
+
+		/* Must be called with the mutex held */
+		void pump(const std::string &uri, lane &l)
+		{
+			while (!l.pending.empty() && !l.writing) {
+				auto access = l.pending.front().first;
+				if (access==document_access::WRITE) {
+					if (l.reading>0) return;
+					l.writing = true;
+				} else {
+					++l.reading;
+				}
+
+				auto job = std::move(l.pending.front().second);
+				l.pending.pop_front();
+
+				thread_pool.queue_job([this, uri, access, job] {
+					struct completion {
+						document_scheduler *scheduler;
+						const std::string &uri;
+						document_access access;
+						~completion() {scheduler->done(uri, access);}
+					} on_exit {this, uri, access};
+
+					job();
+				});
+			}
+		}
+
+		void done(const std::string &uri, document_access access)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			auto it = lanes.find(uri);
+			if (it==lanes.end()) return;
+
+			auto &l = it->second;
+			if (access==document_access::WRITE) l.writing = false;
+			else --l.reading;
+
+			if (l.pending.empty() && l.reading==0 && !l.writing) {
+				lanes.erase(it);
+			} else {
+				pump(uri, l);
+			}
+		}
+
+	private:
+		utils::thread_pool &thread_pool;
+		std::mutex mutex;
+		std::unordered_map<std::string, lane> lanes;
+	};
+}
+
+#endif /* HILL__LSP__SCHEDULER_HH_INCLUDED */
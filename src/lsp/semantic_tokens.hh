@@ -0,0 +1,177 @@
+#ifndef HILL__LSP__SEMANTIC_TOKENS_HH_INCLUDED
+#define HILL__LSP__SEMANTIC_TOKENS_HH_INCLUDED
+
+#include "document_store.hh"
+#include "models.hh"
+#include "../lang_spec.hh"
+#include "../token.hh"
+#include "../utils/cancellation_token.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hill::lsp {
+
+	// Order must match semantic_tokens::legend()
+	enum class semantic_token_type: uint32_t {
+		COMMENT,
+		STRING,
+		NUMBER,
+		VARIABLE,
+		OPERATOR,
+	};
+
+	struct semantic_tokens {
+
+		static models::semantic_tokens_legend legend()
+		{
+			return models::semantic_tokens_legend{
+				.token_types = {"comment", "string", "number", "variable", "operator"},
+				.token_modifiers = {},
+			};
+		}
+
+		static std::optional<semantic_token_type> classify(const token &t)
+		{
+			switch (t.get_type()) {
+			case tt::COMMENT: return semantic_token_type::COMMENT;
+			case tt::STRING:
+			case tt::CHAR: return semantic_token_type::STRING;
+			case tt::NUM: return semantic_token_type::NUMBER;
+			case tt::NAME: return semantic_token_type::VARIABLE;
+			default: break;
+			}
+			if (t.op()) return semantic_token_type::OPERATOR;
+			return {};
+		}
+
+		/**
+		 * Relative encoded token data as described by the protocol, five integers per token.
+		 * Tokens spanning several lines are split per line.
+		 */
+		static std::vector<uint32_t> encode(const document &doc, const utils::cancellation_token &cancellation = {})
+		{
+			auto tokens_ptr = doc.tokens(cancellation);
+			const auto &tokens = *tokens_ptr;
+
+			std::vector<uint32_t> data;
+			uint32_t prev_line = 0, prev_char = 0;
+
+			auto emit = [&](uint32_t line, uint32_t character, uint32_t length, semantic_token_type type) {
+				if (!length) return;
+				data.push_back(line - prev_line);
+				data.push_back(line==prev_line ? character - prev_char : character);
+				data.push_back(length);
+				data.push_back((uint32_t)type);
+				data.push_back(0);
+				prev_line = line;
+				prev_char = character;
+			};
+
+			for (size_t ix=0; ix+1<tokens.size(); ++ix) {
+				auto type = classify(tokens[ix]);
+				if (!type) continue;
+
+				// Tokens cover the text without gaps, so a token ends where the next one starts
+				auto &begin = tokens[ix];
+				auto &end = tokens[ix+1];
+
+				for (auto lix=begin.lix; lix<=end.lix; ++lix) {
+					auto from = lix==begin.lix ? begin.cix : 0;
+					auto to = lix==end.lix ? end.cix : (int)doc.line_length((size_t)lix);
+					if (to>from) emit((uint32_t)lix, (uint32_t)from, (uint32_t)(to-from), *type);
+				}
+			}
+
+			return data;
+		}
+
+		/**
+		 * Single edit replacing everything between the common prefix and suffix
+		 */
+		static std::vector<models::semantic_tokens_edit> diff(const std::vector<uint32_t> &prev, const std::vector<uint32_t> &next)
+		{
+			size_t prefix = 0;
+			while (prefix<prev.size() && prefix<next.size() && prev[prefix]==next[prefix]) ++prefix;
+
+			size_t suffix = 0;
+			while (suffix<prev.size()-prefix && suffix<next.size()-prefix
+					&& prev[prev.size()-1-suffix]==next[next.size()-1-suffix]) {
+				++suffix;
+			}
+
+			if (prefix==prev.size() && prefix==next.size()) return {};
+
+			return {models::semantic_tokens_edit{
+				.start = (uint32_t)prefix,
+				.delete_count = (uint32_t)(prev.size()-prefix-suffix),
+				.data = std::vector<uint32_t>(next.begin()+(std::ptrdiff_t)prefix, next.end()-(std::ptrdiff_t)suffix),
+			}};
+		}
+	};
+
+	/**
+	 * Last result sent for each document, delta requests are answered against it
+	 */
+	struct semantic_tokens_cache {
+		struct result {
+			std::string id;
+			int version;
+			std::shared_ptr<const std::vector<uint32_t>> data;
+		};
+
+		std::optional<result> get(const std::string &uri)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			auto it = results.find(uri);
+			if (it==results.end()) return {};
+			return it->second;
+		}
+
+		/**
+		 * Result for the given document version, reusing the cached data if the version is unchanged
+		 */
+		result update(const document &doc, const utils::cancellation_token &cancellation)
+		{
+			auto prev = get(doc.uri);
+			if (prev && prev->version==doc.version) return *prev;
+
+			auto next = result{
+				.id = std::to_string(++last_id),
+				.version = doc.version,
+				.data = std::make_shared<const std::vector<uint32_t>>(semantic_tokens::encode(doc, cancellation)),
+			};
+
+			std::lock_guard<std::mutex> guard(mutex);
+			results[doc.uri] = next;
+			return next;
+		}
+
+		void remove(const std::string &uri)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			results.erase(uri);
+		}
+
+		size_t approx_bytes()
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			size_t bytes = 0;
+			for (const auto &[uri, res] : results) bytes += uri.capacity() + res.id.capacity() + res.data->capacity()*sizeof(uint32_t);
+			return bytes;
+		}
+
+	private:
+		std::mutex mutex;
+		std::unordered_map<std::string, result> results;
+		std::atomic<uint64_t> last_id = 0;
+	};
+}
+
+#endif /* HILL__LSP__SEMANTIC_TOKENS_HH_INCLUDED */
@@ -6,9 +6,19 @@
 #include "server_state.hh"
 #include "listener.hh"
 #include "logger.hh"
+#include "recorder.hh"
 #include "request_handler.hh"
+#include "scheduler.hh"
+#include "stats.hh"
+#include "writer.hh"
 #include "../utils/thread_pool.hh"
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
 #ifdef _WIN32
 #include <fcntl.h>
 #include <io.h>
@@ -37,12 +47,29 @@ namespace hill::lsp {
 			utils::thread_pool thread_pool;
 			thread_pool.start();
 
+			document_scheduler scheduler(thread_pool);
+
+			server_stats::get().attach(&thread_pool);
+			state.workspace_index.attach(&thread_pool);
+			state.thread_pool = &thread_pool;
+			std::jthread stats_thread(&server::stats_loop);
+
+			logger::info("Starting writer ...");
+			writer::start();
+
 			while (state.running) {
 				logger::trace("Receiving ...");
 				auto req = listener::next();
 				if (!req) continue;
 
-				thread_pool.queue_job([req] {request_handler::handle(*req);});
+				auto job = request_handler::accept(*req);
+				if (!job) continue;
+
+				if (job->uri) {
+					scheduler.schedule(*job->uri, job->access, job->run);
+				} else {
+					thread_pool.queue_job(job->run);
+				}
 			}
 
 			logger::info("Shutting down ...");
@@ -51,8 +78,42 @@ namespace hill::lsp {
 			thread_pool.stop();
 			logger::info("Joining thread pool ...");
 			thread_pool.join();
+			state.thread_pool = nullptr;
+			logger::info("Stopping writer ...");
+			writer::stop();
+
+			stats_thread.request_stop();
+			stats_thread.join();
+			logger::info([] {return server_stats::get().str();});
+			server_stats::get().attach(nullptr);
+
+			state.workspace_index.attach(nullptr);
+			state.workspace_index.save();
 
+			recorder::close();
 			logger::info("Successfully shut down");
+			logger::close();
+		}
+
+	private:
+		static constexpr auto STATS_INTERVAL = std::chrono::seconds(60);
+
+		/**
+		 * Periodically dump the stats to the log while there is activity
+		 */
+		static void stats_loop(std::stop_token stop)
+		{
+			std::mutex mutex;
+			std::condition_variable_any cond;
+			uint64_t last_total = 0;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!cond.wait_for(lock, stop, STATS_INTERVAL, [] {return false;}) && !stop.stop_requested()) {
+				auto total = server_stats::get().total_count();
+				if (total==last_total) continue;
+				last_total = total;
+				logger::info([] {return server_stats::get().str();});
+			}
 		}
 	};
 }
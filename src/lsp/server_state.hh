@@ -1,52 +1,54 @@
 #ifndef HILL__LSP__SERVER_STATE_HH_INCLUDED
 #define HILL__LSP__SERVER_STATE_HH_INCLUDED
 
+#include "diagnostics.hh"
 #include "document_store.hh"
+#include "inlay_hints.hh"
 #include "models.hh"
+#include "semantic_tokens.hh"
+#include "workspace_index.hh"
+#include "../utils/cancellation_token.hh"
+#include "../utils/thread_pool.hh"
 
 #include <atomic>
-#include <set>
+#include <map>
 #include <mutex>
 
 namespace hill::lsp {
 
 	struct request_state {
-		void on_recv(int req_id)
+		utils::cancellation_token on_recv(int req_id)
 		{
 			std::lock_guard<std::mutex> guard(mutex);
-			in_flight_requests.insert(req_id);
+			auto cancellation = utils::cancellation_token::create();
+			in_flight_requests[req_id] = cancellation;
+			return cancellation;
 		}
 
 		void on_complete(int req_id)
 		{
 			std::lock_guard<std::mutex> guard(mutex);
 			in_flight_requests.erase(req_id);
-			if (cancel_request_ids.contains(req_id)) {
-				cancel_request_ids.erase(req_id);
-			}
 		}
 
 		bool on_cancel(int req_id)
 		{
 			std::lock_guard<std::mutex> guard(mutex);
-			if (in_flight_requests.contains(req_id)) {
-				cancel_request_ids.insert(req_id);
-				return true;
-			} else {
-				return false;
-			}
+			if (!in_flight_requests.contains(req_id)) return false;
+
+			in_flight_requests.at(req_id).cancel();
+			return true;
 		}
 
 		bool cancelled(int req_id)
 		{
 			std::lock_guard<std::mutex> guard(mutex);
-			return cancel_request_ids.contains(req_id);
+			return in_flight_requests.contains(req_id) && in_flight_requests.at(req_id).cancelled();
 		}
 
 	private:
 		std::mutex mutex;
-		std::set<int> in_flight_requests;
-		std::set<int> cancel_request_ids;
+		std::map<int, utils::cancellation_token> in_flight_requests;
 	};
 
 	struct server_state {
@@ -55,15 +57,40 @@ namespace hill::lsp {
 
 		lsp::document_store document_store;
 		lsp::request_state request_state;
+		lsp::semantic_tokens_cache semantic_tokens_cache;
+		lsp::inlay_hint_cache inlay_hint_cache;
+		lsp::workspace_index workspace_index;
+		std::atomic<utils::thread_pool *> thread_pool = nullptr; // Set while the server runs
 
 		const models::server_capabilities server_capabilities = {
 			.position_encoding = models::position_encoding_kind::UTF16,
-			.text_document_sync = models::text_document_sync_kind::FULL,
+			.text_document_sync = models::text_document_sync_kind::INCREMENTAL,
 			.completion_provider = models::completion_options{},
 			.hover_provider = true,
+			.definition_provider = true,
+			.references_provider = true,
 			.document_formatting_provider = true,
+			.semantic_tokens_provider = models::semantic_tokens_options{
+				.legend = semantic_tokens::legend(),
+				.range = false,
+				.full_delta = true,
+			},
+			.workspace_symbol_provider = true,
+			.inlay_hint_provider = true,
+			.diagnostic_provider = models::diagnostic_options{
+				.inter_file_dependencies = false,
+				.workspace_diagnostics = true,
+			},
 		};
 
+		server_state()
+		{
+			document_store.on_evict = [this](const std::string &uri) {
+				semantic_tokens_cache.remove(uri);
+				inlay_hint_cache.remove(uri);
+			};
+		}
+
 		static server_state &get()
 		{
 			static server_state state;
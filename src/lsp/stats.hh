@@ -0,0 +1,147 @@
+#ifndef HILL__LSP__STATS_HH_INCLUDED
+#define HILL__LSP__STATS_HH_INCLUDED
+
+#include "models.hh"
+#include "../utils/histogram.hh"
+#include "../utils/json.hh"
+#include "../utils/thread_pool.hh"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace hill::lsp {
+
+	/**
+	 * Counters and latency histograms for one method, all times in microseconds.
+	 * Queue wait is measured from when the message was read until a worker started it.
+	 */
+	struct method_stats {
+		std::atomic<uint64_t> count = 0;
+		std::atomic<uint64_t> errors = 0;
+		std::atomic<uint64_t> cancelled = 0;
+		utils::histogram queue_wait;
+		utils::histogram exec;
+
+		static uint64_t us_between(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+		}
+	};
+
+	struct server_stats {
+		method_stats &for_method(models::method m)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			auto &ptr = methods[m];
+			if (!ptr) ptr = std::make_unique<method_stats>();
+			return *ptr;
+		}
+
+		void attach(const utils::thread_pool *pool)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			thread_pool = pool;
+		}
+
+		uint64_t total_count()
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			uint64_t total = 0;
+			for (const auto &[m, stats] : methods) total += stats->count.load(std::memory_order_relaxed);
+			return total;
+		}
+
+		std::shared_ptr<utils::json_value> json()
+		{
+			using namespace ::hill::utils;
+			std::lock_guard<std::mutex> guard(mutex);
+
+			auto json = json_value::create<json_value_kind::OBJECT>();
+
+			auto methods_json = *json->obj_add_obj("methods");
+			for (const auto &[m, stats] : methods) {
+				auto method_json = *methods_json->obj_add_obj(models::method_str(m));
+				method_json->obj_add_num("count", (double)stats->count.load(std::memory_order_relaxed));
+				method_json->obj_add_num("errors", (double)stats->errors.load(std::memory_order_relaxed));
+				method_json->obj_add_num("cancelled", (double)stats->cancelled.load(std::memory_order_relaxed));
+				method_json->obj_add_obj("queueWaitUs", histogram_json(stats->queue_wait));
+				method_json->obj_add_obj("execUs", histogram_json(stats->exec));
+			}
+
+			if (thread_pool) {
+				auto pool_json = *json->obj_add_obj("threadPool");
+				pool_json->obj_add_num("threads", (double)thread_pool->thread_count());
+				pool_json->obj_add_num("queueDepth", (double)thread_pool->queue_depth());
+				pool_json->obj_add_num("maxQueueDepth", (double)thread_pool->get_max_queue_depth());
+				pool_json->obj_add_obj("queueWaitUs", histogram_json(thread_pool->get_queue_wait()));
+			}
+
+			return json;
+		}
+
+		/**
+		 * One line per method, meant for the log
+		 */
+		std::string str()
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			std::stringstream ss;
+
+			ss << "Stats (us)";
+			for (const auto &[m, stats] : methods) {
+				ss << "\n  " << models::method_str(m)
+					<< " count<" << stats->count.load(std::memory_order_relaxed)
+					<< "> errors<" << stats->errors.load(std::memory_order_relaxed)
+					<< "> cancelled<" << stats->cancelled.load(std::memory_order_relaxed)
+					<< "> wait<" << histogram_str(stats->queue_wait)
+					<< "> exec<" << histogram_str(stats->exec) << '>';
+			}
+			if (thread_pool) {
+				ss << "\n  thread pool depth<" << thread_pool->queue_depth()
+					<< "> max depth<" << thread_pool->get_max_queue_depth()
+					<< "> wait<" << histogram_str(thread_pool->get_queue_wait()) << '>';
+			}
+
+			return ss.str();
+		}
+
+		static server_stats &get()
+		{
+			static server_stats stats;
+			return stats;
+		}
+
+	private:
+		static std::shared_ptr<utils::json_value> histogram_json(const utils::histogram &h)
+		{
+			auto json = utils::json_value::create<utils::json_value_kind::OBJECT>();
+			json->obj_add_num("count", (double)h.count());
+			json->obj_add_num("mean", h.mean());
+			json->obj_add_num("p50", (double)h.percentile(50.0));
+			json->obj_add_num("p90", (double)h.percentile(90.0));
+			json->obj_add_num("p99", (double)h.percentile(99.0));
+			json->obj_add_num("max", (double)h.max());
+			return json;
+		}
+
+		static std::string histogram_str(const utils::histogram &h)
+		{
+			return "p50=" + std::to_string(h.percentile(50.0))
+				+ " p90=" + std::to_string(h.percentile(90.0))
+				+ " p99=" + std::to_string(h.percentile(99.0))
+				+ " max=" + std::to_string(h.max());
+		}
+
+	private:
+		std::mutex mutex;
+		std::map<models::method, std::unique_ptr<method_stats>> methods;
+		const utils::thread_pool *thread_pool = nullptr;
+	};
+}
+
+#endif /* HILL__LSP__STATS_HH_INCLUDED */
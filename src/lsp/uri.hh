@@ -0,0 +1,70 @@
+#ifndef HILL__LSP__URI_HH_INCLUDED
+#define HILL__LSP__URI_HH_INCLUDED
+
+#include <cctype>
+#include <string>
+#include <string_view>
+
+namespace hill::lsp::uri {
+
+	/**
+	 * Local path of a file:// uri, empty for other schemes
+	 */
+	inline std::string to_path(std::string_view uri)
+	{
+		constexpr std::string_view scheme = "file://";
+		if (!uri.starts_with(scheme)) return "";
+		uri.remove_prefix(scheme.size());
+
+		auto hex = [](char ch) {
+			if (ch>='0' && ch<='9') return ch-'0';
+			if (ch>='a' && ch<='f') return ch-'a'+10;
+			if (ch>='A' && ch<='F') return ch-'A'+10;
+			return -1;
+		};
+
+		std::string path;
+		for (size_t ix=0; ix<uri.size(); ++ix) {
+			if (uri[ix]=='%' && ix+2<uri.size() && hex(uri[ix+1])>=0 && hex(uri[ix+2])>=0) {
+				path += (char)(hex(uri[ix+1])*16 + hex(uri[ix+2]));
+				ix += 2;
+			} else {
+				path += uri[ix];
+			}
+		}
+
+#ifdef _WIN32
+		// file:///c:/dir -> c:/dir
+		if (path.size()>=3 && path[0]=='/' && path[2]==':') path.erase(0, 1);
+#endif
+		return path;
+	}
+
+	/**
+	 * file:// uri of a local path, encoded the way editors send them
+	 */
+	inline std::string from_path(std::string_view path)
+	{
+		static const char *digits = "0123456789ABCDEF";
+
+		std::string uri = "file://";
+#ifdef _WIN32
+		if (!path.starts_with('/')) uri += '/';
+#endif
+		for (unsigned char ch : path) {
+#ifdef _WIN32
+			if (ch=='\\') ch = '/';
+#endif
+			if (std::isalnum(ch) || ch=='/' || ch=='-' || ch=='_' || ch=='.' || ch=='~') {
+				uri += (char)ch;
+			} else {
+				uri += '%';
+				uri += digits[ch>>4];
+				uri += digits[ch&0xf];
+			}
+		}
+		return uri;
+	}
+}
+
+#endif /* HILL__LSP__URI_HH_INCLUDED */
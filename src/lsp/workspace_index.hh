@@ -0,0 +1,659 @@
+#ifndef HILL__LSP__WORKSPACE_INDEX_HH_INCLUDED
+#define HILL__LSP__WORKSPACE_INDEX_HH_INCLUDED
+
+#include "document_store.hh"
+#include "logger.hh"
+#include "models.hh"
+#include "uri.hh"
+#include "../token.hh"
+#include "../utils/string.hh"
+#include "../utils/thread_pool.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace hill::lsp {
+
+	/**
+	 * Every name bound with := and every use of a name in the .hill files of the workspace.
+	 * Built in parallel on the thread pool, persisted to a cache file between runs
+	 * and kept up to date from editor changes and file system events.
+	 */
+	struct workspace_index {
+		struct symbol {
+			std::string name;
+			uint32_t lix, cix;
+			bool is_binding;
+		};
+
+		struct file {
+			std::string uri;
+			uint64_t size = 0;
+			int64_t mtime = 0;
+			uint64_t hash = 0; // Of the content, files with the same hash are not scanned again
+			std::vector<symbol> symbols; // In text order
+		};
+
+		struct match {
+			std::string uri;
+			symbol sym;
+		};
+
+		static bool is_indexed(std::string_view uri) {return uri.ends_with(".hill");}
+
+		static bool read_file(const std::string &path, std::string &content)
+		{
+			std::ifstream istr(path, std::ios::binary | std::ios::ate);
+			if (!istr) return false;
+			content.resize((size_t)istr.tellg());
+			istr.seekg(0);
+			return (bool)istr.read(content.data(), (std::streamsize)content.size());
+		}
+
+		/**
+		 * Names in a token stream, a name followed by := is a binding
+		 */
+		static std::vector<symbol> scan(const std::vector<token> &tokens)
+		{
+			std::vector<symbol> symbols;
+
+			for (size_t ix=0; ix<tokens.size(); ++ix) {
+				if (tokens[ix].get_type()!=tt::NAME) continue;
+
+				size_t next = ix+1;
+				while (next<tokens.size() && (tokens[next].ws() || tokens[next].get_type()==tt::COMMENT)) ++next;
+
+				symbols.push_back(symbol{
+					.name = tokens[ix].get_text(),
+					.lix = (uint32_t)tokens[ix].lix,
+					.cix = (uint32_t)tokens[ix].cix,
+					.is_binding = next<tokens.size() && tokens[next].get_type()==tt::OP_COLON_EQ});
+			}
+
+			return symbols;
+		}
+
+		/**
+		 * The symbol covering the position, symbols must be in text order
+		 */
+		static const symbol *symbol_at(const std::vector<symbol> &symbols, uint32_t lix, uint32_t cix)
+		{
+			auto it = std::upper_bound(symbols.begin(), symbols.end(), std::make_pair(lix, cix),
+				[](const std::pair<uint32_t, uint32_t> &pos, const symbol &sym) {return pos < std::make_pair(sym.lix, sym.cix);});
+			if (it==symbols.begin()) return nullptr;
+			--it;
+			return it->lix==lix && cix<=it->cix+it->name.size() ? &*it : nullptr;
+		}
+
+		/**
+		 * Pool used for building and reloading, without one the work is done on the calling thread
+		 */
+		void attach(utils::thread_pool *pool)
+		{
+			this->pool.store(pool);
+		}
+
+		void set_roots(const std::vector<std::string> &root_uris)
+		{
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			roots.clear();
+			for (const auto &root_uri : root_uris) {
+				auto path = uri::to_path(root_uri);
+				if (!path.empty()) roots.push_back(path);
+			}
+		}
+
+		/**
+		 * Directory of the cache file, from initializationOptions, instead of the per-user cache directory
+		 */
+		void set_cache_dir(const std::string &dir)
+		{
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			cache_dir = dir;
+		}
+
+		/**
+		 * Index the workspace folders, reusing what the cache file has for unchanged files
+		 */
+		void start()
+		{
+			run([this] {build();});
+		}
+
+		/**
+		 * Index the editor content of an open document instead of the file on disk
+		 */
+		void update(const document &doc)
+		{
+			if (!is_indexed(doc.uri)) return;
+
+			auto f = std::make_shared<file>();
+			f->uri = doc.uri;
+			f->hash = utils::fnv1a_64(doc.text);
+			f->symbols = scan(*doc.tokens());
+
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			open_uris.insert(doc.uri);
+			install(std::move(f));
+		}
+
+		/**
+		 * The document was closed in the editor, go back to what is on disk
+		 */
+		void close(const std::string &uri)
+		{
+			if (!is_indexed(uri)) return;
+			{
+				std::unique_lock<std::shared_mutex> lock(mutex);
+				open_uris.erase(uri);
+			}
+			reload(uri);
+		}
+
+		void file_changed(const std::string &uri, models::file_change_type type)
+		{
+			if (!is_indexed(uri)) return;
+
+			if (type==models::file_change_type::DELETED) {
+				std::unique_lock<std::shared_mutex> lock(mutex);
+				if (!open_uris.contains(uri)) uninstall(uri);
+			} else {
+				reload(uri);
+			}
+		}
+
+		/**
+		 * Bindings whose name contains the query, ignoring case, ordered by name
+		 */
+		std::vector<match> search(std::string_view query, size_t limit) const
+		{
+			std::string lquery = lower(query);
+			std::vector<match> matches;
+
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			std::vector<const std::pair<const std::string, std::vector<std::string>> *> found;
+			for (const auto &entry : name_uris) {
+				if (lower(entry.first).find(lquery)!=std::string::npos) found.push_back(&entry);
+			}
+			std::sort(found.begin(), found.end(), [](const auto *a, const auto *b) {return a->first < b->first;});
+
+			for (const auto *entry : found) {
+				const auto &name = entry->first;
+				for (const auto &uri : entry->second) {
+					for (const auto &sym : files.at(uri)->symbols) {
+						if (!sym.is_binding || sym.name!=name) continue;
+						if (matches.size()==limit) return matches;
+						matches.push_back(match{.uri = uri, .sym = sym});
+					}
+				}
+			}
+			return matches;
+		}
+
+		/**
+		 * Every occurrence of the name, or only where it is bound
+		 */
+		std::vector<match> find(const std::string &name, bool bindings_only) const
+		{
+			std::vector<match> matches;
+
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto it = name_uris.find(name);
+			if (it==name_uris.end()) return matches;
+
+			for (const auto &uri : it->second) {
+				for (const auto &sym : files.at(uri)->symbols) {
+					if (sym.name!=name || (bindings_only && !sym.is_binding)) continue;
+					matches.push_back(match{.uri = uri, .sym = sym});
+				}
+			}
+			return matches;
+		}
+
+		/**
+		 * Uri and content hash of every indexed file
+		 */
+		std::vector<std::pair<std::string, uint64_t>> file_hashes() const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			std::vector<std::pair<std::string, uint64_t>> hashes;
+			hashes.reserve(files.size());
+			for (const auto &[uri, f] : files) hashes.emplace_back(uri, f->hash);
+			return hashes;
+		}
+
+		size_t file_count() const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return files.size();
+		}
+
+		bool ready() const {return is_ready.load();}
+
+		size_t approx_bytes() const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			size_t bytes = 0;
+			for (const auto &[uri, f] : files) {
+				bytes += sizeof(file) + 2*uri.capacity() + f->symbols.capacity()*sizeof(symbol);
+				for (const auto &sym : f->symbols) bytes += sym.name.size()>15 ? sym.name.capacity() : 0; // Beyond the small string buffer
+			}
+			for (const auto &[name, uris] : name_uris) bytes += name.capacity() + uris.capacity()*sizeof(std::string);
+			return bytes;
+		}
+
+		/**
+		 * Write the index of the files on disk to the cache file, if it changed since it was loaded
+		 */
+		void save()
+		{
+			std::string path;
+			std::vector<std::shared_ptr<const file>> saved;
+			{
+				std::shared_lock<std::shared_mutex> lock(mutex);
+				if (!dirty.exchange(false) || roots.empty()) return;
+				path = cache_path();
+				if (path.empty()) return;
+				for (const auto &[uri, f] : files) {
+					// Open documents may differ from disk, they are scanned again next time
+					if (!open_uris.contains(uri)) saved.push_back(f);
+				}
+			}
+
+			std::error_code ec;
+			std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+			auto tmp_path = path + ".tmp";
+			{
+				std::ofstream ostr(tmp_path, std::ios::binary | std::ios::trunc);
+				if (!ostr) {
+					logger::error([&] {return "Failed to write workspace index cache " + tmp_path;});
+					return;
+				}
+
+				write_u64(ostr, CACHE_MAGIC);
+				write_u64(ostr, saved.size());
+				for (const auto &f : saved) {
+					write_str(ostr, f->uri);
+					write_u64(ostr, f->size);
+					write_u64(ostr, (uint64_t)f->mtime);
+					write_u64(ostr, f->hash);
+					write_u64(ostr, f->symbols.size());
+					for (const auto &sym : f->symbols) {
+						write_str(ostr, sym.name);
+						write_u64(ostr, ((uint64_t)sym.lix << 32) | sym.cix);
+						ostr.put(sym.is_binding ? 1 : 0);
+					}
+				}
+			}
+
+			// Replaced in one step so a crash never leaves a half written cache
+			std::filesystem::rename(tmp_path, path, ec);
+			if (ec) logger::error([&] {return "Failed to replace workspace index cache " + path;});
+		}
+
+	private:
+		static constexpr uint64_t CACHE_MAGIC = 0x3130'5844'4E49'4C48ull; // "HLINDX01"
+		enum {SCAN_BATCH = 64};
+
+		mutable std::shared_mutex mutex;
+		std::vector<std::string> roots;
+		std::string cache_dir; // Empty for the per-user cache directory
+		std::unordered_map<std::string, std::shared_ptr<const file>> files;
+		std::unordered_map<std::string, std::vector<std::string>> name_uris; // Name -> files using it
+		std::unordered_set<std::string> open_uris;
+
+		std::atomic<utils::thread_pool *> pool = nullptr;
+		std::atomic<bool> is_ready = false;
+		std::atomic<bool> dirty = false;
+
+		struct pending_scan {
+			std::string path;
+			std::string uri;
+			uint64_t size;
+			int64_t mtime;
+			std::shared_ptr<const file> cached;
+		};
+
+		template<typename FN> void run(FN &&fn)
+		{
+			if (auto p = pool.load()) p->queue_job(std::forward<FN>(fn));
+			else fn();
+		}
+
+		static std::string lower(std::string_view s)
+		{
+			std::string res(s);
+			for (auto &ch : res) ch = (char)std::tolower((unsigned char)ch);
+			return res;
+		}
+
+		/**
+		 * Size and modification time with a single stat, false if the file is gone
+		 */
+		static bool stat_file(const std::string &path, uint64_t &size, int64_t &mtime)
+		{
+#ifdef _WIN32
+			std::error_code ec;
+			size = std::filesystem::file_size(path, ec);
+			if (ec) return false;
+			mtime = (int64_t)std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+			return !ec;
+#else
+			struct stat st;
+			if (::stat(path.c_str(), &st)!=0) return false;
+			size = (uint64_t)st.st_size;
+			mtime = (int64_t)st.st_mtim.tv_sec*1'000'000'000 + st.st_mtim.tv_nsec;
+			return true;
+#endif
+		}
+
+		static std::vector<std::string_view> distinct_names(const file &f)
+		{
+			std::vector<std::string_view> names;
+			names.reserve(f.symbols.size());
+			for (const auto &sym : f.symbols) names.push_back(sym.name);
+			std::sort(names.begin(), names.end());
+			names.erase(std::unique(names.begin(), names.end()), names.end());
+			return names;
+		}
+
+		/**
+		 * Replace the entry of a file, the lock must be held
+		 */
+		void install(std::shared_ptr<const file> f)
+		{
+			uninstall(f->uri);
+			for (const auto &name : distinct_names(*f)) name_uris[std::string(name)].push_back(f->uri);
+			files[f->uri] = std::move(f);
+		}
+
+		void uninstall(const std::string &uri)
+		{
+			auto it = files.find(uri);
+			if (it==files.end()) return;
+
+			for (const auto &name : distinct_names(*it->second)) {
+				auto nit = name_uris.find(std::string(name));
+				if (nit==name_uris.end()) continue;
+				std::erase(nit->second, uri);
+				if (nit->second.empty()) name_uris.erase(nit);
+			}
+			files.erase(it);
+			dirty = true;
+		}
+
+		/**
+		 * Install a file read from disk, unless the editor owns it by now
+		 */
+		void install_from_disk(std::shared_ptr<const file> f)
+		{
+			std::unique_lock<std::shared_mutex> lock(mutex);
+			if (open_uris.contains(f->uri)) return;
+			install(std::move(f));
+			dirty = true;
+		}
+
+		static std::shared_ptr<const file> scan_file(const pending_scan &ps)
+		{
+			std::string text;
+			if (!read_file(ps.path, text)) return nullptr;
+
+			auto f = std::make_shared<file>();
+			f->uri = ps.uri;
+			f->size = ps.size;
+			f->mtime = ps.mtime;
+			f->hash = utils::fnv1a_64(text);
+
+			if (ps.cached && ps.cached->hash==f->hash) {
+				f->symbols = ps.cached->symbols; // Touched but not changed
+			} else {
+				document doc(ps.uri, 0, text);
+				f->symbols = scan(*doc.tokens());
+			}
+			return f;
+		}
+
+		void reload(const std::string &uri)
+		{
+			run([this, uri] {
+				auto path = uri::to_path(uri);
+				uint64_t size = 0;
+				int64_t mtime = 0;
+				if (!stat_file(path, size, mtime)) {
+					std::unique_lock<std::shared_mutex> lock(mutex);
+					if (!open_uris.contains(uri)) uninstall(uri);
+					return;
+				}
+
+				std::shared_ptr<const file> cached;
+				{
+					std::shared_lock<std::shared_mutex> lock(mutex);
+					auto it = files.find(uri);
+					if (it!=files.end()) cached = it->second;
+				}
+
+				auto f = scan_file(pending_scan{.path = path, .uri = uri, .size = size, .mtime = mtime, .cached = cached});
+				if (f) install_from_disk(std::move(f));
+			});
+		}
+
+		void build()
+		{
+			auto started = std::chrono::steady_clock::now();
+
+			std::vector<std::string> roots;
+			{
+				std::shared_lock<std::shared_mutex> lock(mutex);
+				roots = this->roots;
+			}
+
+			auto cached = load();
+			std::vector<pending_scan> scans;
+			size_t reused = 0;
+
+			for (const auto &root : roots) {
+				std::error_code ec;
+				auto it = std::filesystem::recursive_directory_iterator(root,
+					std::filesystem::directory_options::skip_permission_denied, ec);
+				for (; !ec && it!=std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+					const auto &path = it->path();
+					if (it->is_directory(ec)) {
+						if (path.filename().string().starts_with('.')) it.disable_recursion_pending();
+						continue;
+					}
+					if (path.extension()!=".hill" || !it->is_regular_file(ec)) continue;
+
+					auto ps = pending_scan{
+						.path = path.string(),
+						.uri = uri::from_path(path.string()),
+						.size = 0,
+						.mtime = 0,
+						.cached = nullptr};
+					if (!stat_file(ps.path, ps.size, ps.mtime)) continue;
+
+					auto cit = cached.find(ps.uri);
+					if (cit!=cached.end()) {
+						if (cit->second->size==ps.size && cit->second->mtime==ps.mtime) {
+							std::unique_lock<std::shared_mutex> lock(mutex);
+							if (!open_uris.contains(ps.uri)) install(cit->second);
+							++reused;
+							continue;
+						}
+						ps.cached = cit->second;
+					}
+					scans.push_back(std::move(ps));
+				}
+			}
+
+			// Files that are gone or changed are not in the cache file any more
+			if (!scans.empty() || reused!=cached.size()) dirty = true;
+
+			logger::info([&] {return "Workspace index: " + std::to_string(reused) + " files from cache, "
+				+ std::to_string(scans.size()) + " to scan";});
+
+			auto batches = std::make_shared<std::atomic<size_t>>((scans.size()+SCAN_BATCH-1)/SCAN_BATCH);
+			auto shared_scans = std::make_shared<const std::vector<pending_scan>>(std::move(scans));
+
+			auto finish = [this, started] {
+				is_ready = true;
+				save();
+				logger::info([&] {return "Workspace index ready: " + std::to_string(file_count()) + " files in "
+					+ std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-started).count()) + " ms";});
+			};
+
+			if (*batches==0) {
+				finish();
+				return;
+			}
+
+			for (size_t begin=0; begin<shared_scans->size(); begin+=SCAN_BATCH) {
+				run([this, begin, batches, shared_scans, finish] {
+					auto end = std::min<size_t>(begin+SCAN_BATCH, shared_scans->size());
+					for (size_t ix=begin; ix<end; ++ix) {
+						if (auto f = scan_file((*shared_scans)[ix])) install_from_disk(std::move(f));
+					}
+					if (batches->fetch_sub(1)==1) finish();
+				});
+			}
+		}
+
+		/**
+		 * Per-user cache directory, empty if the environment names none
+		 */
+		static std::filesystem::path default_cache_dir()
+		{
+#ifdef _WIN32
+			if (auto local = std::getenv("LOCALAPPDATA"); local && *local) return std::filesystem::path(local) / "hill";
+#else
+			if (auto xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) return std::filesystem::path(xdg) / "hill";
+			if (auto home = std::getenv("HOME"); home && *home) return std::filesystem::path(home) / ".cache" / "hill";
+#endif
+			return {};
+		}
+
+		/**
+		 * One cache file per set of workspace folders, empty when there is nowhere to put it
+		 */
+		std::string cache_path() const
+		{
+			auto dir = cache_dir.empty() ? default_cache_dir() : std::filesystem::path(cache_dir);
+			if (dir.empty()) return {};
+
+			std::string key;
+			for (const auto &root : roots) key += root + '\n';
+
+			std::ostringstream ss;
+			ss << "hill-lsp-index-" << std::hex << utils::fnv1a_64(key) << ".bin";
+			return (dir / ss.str()).string();
+		}
+
+		std::unordered_map<std::string, std::shared_ptr<const file>> load() const
+		{
+			std::unordered_map<std::string, std::shared_ptr<const file>> cached;
+
+			std::string path;
+			{
+				std::shared_lock<std::shared_mutex> lock(mutex);
+				path = cache_path();
+			}
+			if (path.empty()) return cached;
+
+			cache_reader reader;
+			if (!read_file(path, reader.data)) return cached;
+
+			uint64_t magic = 0, file_cnt = 0;
+			if (!reader.u64(magic) || magic!=CACHE_MAGIC || !reader.u64(file_cnt)) return cached;
+
+			for (uint64_t fix=0; fix<file_cnt; ++fix) {
+				auto f = std::make_shared<file>();
+				uint64_t mtime = 0, sym_cnt = 0;
+				if (!reader.str(f->uri) || !reader.u64(f->size) || !reader.u64(mtime)
+						|| !reader.u64(f->hash) || !reader.u64(sym_cnt) || sym_cnt>reader.data.size()) {
+					return {}; // Truncated, start over
+				}
+				f->mtime = (int64_t)mtime;
+
+				f->symbols.resize(sym_cnt);
+				for (auto &sym : f->symbols) {
+					uint64_t pos = 0;
+					uint8_t is_binding = 0;
+					if (!reader.str(sym.name) || !reader.u64(pos) || !reader.u8(is_binding)) return {};
+					sym.lix = (uint32_t)(pos >> 32);
+					sym.cix = (uint32_t)pos;
+					sym.is_binding = is_binding==1;
+				}
+				cached[f->uri] = std::move(f);
+			}
+
+			return cached;
+		}
+
+		static void write_u64(std::ostream &ostr, uint64_t v)
+		{
+			uint8_t bytes[8];
+			for (int ix=0; ix<8; ++ix) bytes[ix] = (uint8_t)(v >> (8*ix));
+			ostr.write((const char *)bytes, sizeof bytes);
+		}
+
+		static void write_str(std::ostream &ostr, const std::string &s)
+		{
+			write_u64(ostr, s.size());
+			ostr.write(s.data(), (std::streamsize)s.size());
+		}
+
+		/**
+		 * Reads the cache file from memory, every read fails once the data runs out
+		 */
+		struct cache_reader {
+			std::string data;
+			size_t pos = 0;
+
+			bool u8(uint8_t &v)
+			{
+				if (pos+1>data.size()) return false;
+				v = (uint8_t)data[pos++];
+				return true;
+			}
+
+			bool u64(uint64_t &v)
+			{
+				if (pos+8>data.size()) return false;
+				v = 0;
+				for (int ix=0; ix<8; ++ix) v |= (uint64_t)(uint8_t)data[pos+ix] << (8*ix);
+				pos += 8;
+				return true;
+			}
+
+			bool str(std::string &s)
+			{
+				uint64_t size = 0;
+				if (!u64(size) || size>data.size()-pos) return false;
+				s.assign(data, pos, size);
+				pos += size;
+				return true;
+			}
+		};
+	};
+}
+
+#endif /* HILL__LSP__WORKSPACE_INDEX_HH_INCLUDED */
@@ -0,0 +1,171 @@
+#ifndef HILL__LSP__WRITER_HH_INCLUDED
+#define HILL__LSP__WRITER_HH_INCLUDED
+
+#include "models.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace hill::lsp {
+
+	/**
+	 * Single writer for everything the server sends to the client.
+	 *
+	 * Workers only append the serialized message to a queue. A dedicated thread
+	 * takes every message that is ready and writes them with one writev call,
+	 * so finishing workers never wait on each other for stdout.
+	 */
+	struct writer {
+		writer() = delete;
+
+		static void start()
+		{
+			auto &s = get_state();
+			std::lock_guard<std::mutex> guard(s.mutex);
+			if (s.thread.joinable()) return;
+
+			s.stopping = false;
+			s.thread = std::thread(&writer::write_loop);
+		}
+
+		/**
+		 * Write everything still queued and stop the writer thread
+		 */
+		static void stop()
+		{
+			auto &s = get_state();
+			{
+				std::lock_guard<std::mutex> guard(s.mutex);
+				if (!s.thread.joinable()) return;
+				s.stopping = true;
+			}
+			s.cond.notify_one();
+			s.thread.join();
+		}
+
+		static void send(const models::response_message &msg)
+		{
+			send(msg.json()->stringify());
+		}
+
+		static void send(const models::notification_message &msg)
+		{
+			send(msg.json()->stringify());
+		}
+
+		/**
+		 * Messages queued while the writer thread is not running, the tests call handlers without it
+		 */
+		static std::vector<std::string> take_queued()
+		{
+			auto &s = get_state();
+			std::lock_guard<std::mutex> guard(s.mutex);
+			return std::exchange(s.queue, {});
+		}
+
+	private:
+		struct state {
+			std::mutex mutex;
+			std::condition_variable cond;
+			std::vector<std::string> queue;
+			bool stopping = false;
+			std::thread thread;
+		};
+
+		static state &get_state()
+		{
+			static state s;
+			return s;
+		}
+
+		static void send(std::string &&body)
+		{
+			auto &s = get_state();
+			{
+				std::lock_guard<std::mutex> guard(s.mutex);
+				s.queue.emplace_back(std::move(body));
+			}
+			s.cond.notify_one();
+		}
+
+		static void write_loop()
+		{
+			auto &s = get_state();
+			std::vector<std::string> batch;
+
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock(s.mutex);
+					s.cond.wait(lock, [&s] {return !s.queue.empty() || s.stopping;});
+					if (s.queue.empty()) return; // Stopping and nothing left to write
+					std::swap(batch, s.queue);
+				}
+
+				write_batch(batch);
+				batch.clear();
+			}
+		}
+
+		static void write_batch(const std::vector<std::string> &bodies)
+		{
+			std::vector<std::string> headers;
+			headers.reserve(bodies.size());
+			for (const auto &body : bodies) {
+				headers.emplace_back("Content-Length: " + std::to_string(body.size()) + "\r\n\r\n");
+			}
+
+#ifdef _WIN32
+			std::string buf;
+			for (size_t ix=0; ix<bodies.size(); ++ix) {
+				buf += headers[ix];
+				buf += bodies[ix];
+			}
+			fwrite(buf.c_str(), 1, buf.size(), stdout);
+			fflush(stdout);
+#else
+			std::vector<iovec> iov;
+			iov.reserve(bodies.size()*2);
+			for (size_t ix=0; ix<bodies.size(); ++ix) {
+				iov.push_back(iovec{.iov_base = headers[ix].data(), .iov_len = headers[ix].size()});
+				iov.push_back(iovec{.iov_base = (void *)bodies[ix].data(), .iov_len = bodies[ix].size()});
+			}
+
+			size_t first = 0;
+			while (first<iov.size()) {
+				int cnt = (int)std::min(iov.size()-first, (size_t)IOV_MAX);
+				auto written = ::writev(STDOUT_FILENO, &iov[first], cnt);
+				if (written<0) {
+					if (errno==EINTR) continue;
+					return; // Client is gone, nothing sensible left to do
+				}
+
+				// Skip what was written, a short write can stop inside an entry
+				auto left = (size_t)written;
+				while (first<iov.size() && left>=iov[first].iov_len) {
+					left -= iov[first].iov_len;
+					++first;
+				}
+				if (left) {
+					iov[first].iov_base = (char *)iov[first].iov_base + left;
+					iov[first].iov_len -= left;
+				}
+			}
+#endif
+		}
+	};
+}
+
+#endif /* HILL__LSP__WRITER_HH_INCLUDED */
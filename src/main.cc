@@ -3,8 +3,12 @@
 #include "analyzer.hh"
 #include "evaluator.hh"
 #include "hill.hh"
+#include "register_evaluator.hh"
+#include "ssa.hh"
+#include "opt/ssa_passes.hh"
 
 #include "lsp/server.hh"
+#include "lsp/replay.hh"
 #include "fmt/formatter.hh"
 
 #include "utils/junit.hh"
@@ -16,7 +20,10 @@
 
 #include "test/json_parser.hh"
 #include "test/llvm.hh"
+#include "test/ssa.hh"
+#include "test/lsp.hh"
 
+#include <fstream>
 #include <stdlib.h>
 #include <string.h>
 
@@ -24,22 +31,62 @@ static int usage(const char *cmd)
 {
 	std::cerr << "Usage: " << cmd << " [command [argument]\n";
 	std::cerr << "Commands:\n";
-	std::cerr << " run <file-path> - Evaluate a file and print the result\n";
+	std::cerr << " run [--dump-ir] <file-path> - Evaluate a file and print the result, optionally dumping the IR before and after optimization\n";
 	std::cerr << " fmt <files/directories> - Run formatter on one or more files/directories\n";
-	std::cerr << " lsp - Run language server\n";
+	std::cerr << " lsp [--record <file-path>] - Run language server, optionally recording all received messages\n";
+	std::cerr << " lsp-replay <file-path> [--max-speed] - Replay a recorded session against the language server and report latencies\n";
 	std::cerr << " repl - Start a Read Evaluate Print Loop\n";
 	std::cerr << " test <subsystem> - Test the selected sub-system (evaluator)\n";
 	std::cerr << "If no command is supplied, all tests will be performed\n";
 	return EXIT_FAILURE;
 }
 
+static int run(const char *path, bool dump_ir)
+{
+	std::ifstream ifstr(path, std::ios::in | std::ios::binary);
+	if (!ifstr) {
+		std::cerr << "Cannot read " << path << '\n';
+		return EXIT_FAILURE;
+	}
+
+	try {
+		::hill::lexer l;
+		::hill::parser p;
+		::hill::analyzer a;
+		p.parse(ifstr, l);
+		a.set_trunk(::hill::build_lib(::hill::build_root()));
+		a.analyze(p.get_rpn());
+		a.optimize();
+
+		auto f = ::hill::ssa::lower(a.get_main_block());
+		if (dump_ir) {
+			std::cerr << "Analyzer: " << a.get_main_block().instrs.size() << " instructions\n";
+			std::cerr << "SSA before optimization: " << f.instr_count() << " instructions\n" << f.to_str();
+		}
+		::hill::opt::optimize(f);
+		if (dump_ir) {
+			std::cerr << "SSA after optimization: " << f.instr_count() << " instructions\n" << f.to_str();
+		}
+
+		::hill::register_evaluator e;
+		std::cout << e.run(f).to_str() << '\n';
+	} catch (::hill::exception &ex) {
+		std::cerr << path << ": " << ex.what() << " (" << ::hill::error_code_to_str(ex.get_error_code()) << ")\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[])
 {
 	bool ok = true;
 
 	if (argc>1) {
 		if (!strcmp(argv[1], "run")) {
-			// TODO: Run file
+			bool dump_ir = argc>2 && !strcmp(argv[2], "--dump-ir");
+			if (argc!=(dump_ir ? 4 : 3)) return usage(argv[0]);
+			return run(argv[dump_ir ? 3 : 2], dump_ir);
 		} else if (!strcmp(argv[1], "fmt")) {
 			::hill::fmt::formatter fmt;
 			// TODO: Handle flags
@@ -48,8 +95,23 @@ int main(int argc, char *argv[])
 				fmt.format(argv[i]);
 			}
 		} else if (!strcmp(argv[1], "lsp")) {
+			if (argc>3 && !strcmp(argv[2], "--record")) {
+				if (!::hill::lsp::recorder::open(argv[3])) {
+					std::cerr << "Failed to open " << argv[3] << " for recording\n";
+					return EXIT_FAILURE;
+				}
+			} else if (argc>2) {
+				return usage(argv[0]);
+			}
 			::hill::lsp::server server;
 			server.run();
+		} else if (!strcmp(argv[1], "lsp-replay")) {
+			if (argc<3) return usage(argv[0]);
+			::hill::lsp::replay::options opts = {
+				.recording = argv[2],
+				.server_path = std::filesystem::exists("/proc/self/exe") ? "/proc/self/exe" : argv[0],
+				.max_speed = argc>3 && !strcmp(argv[3], "--max-speed")};
+			ok = ::hill::lsp::replay::run(opts, std::cout);
 		} else if (!strcmp(argv[1], "repl")) {
 			// TODO: REPL
 		} else if (!strcmp(argv[1], "test")) {
@@ -63,6 +125,8 @@ int main(int argc, char *argv[])
 				else if (!strcmp(argv[2], "evaluator")) {ok = ::hill::test::evaluator(test_session);}
 				else if (!strcmp(argv[2], "json_parser")) {ok = ::hill::test::json_parser(test_session);}
 				else if (!strcmp(argv[2], "llvm")) {ok = ::hill::test::llvm(test_session);}
+				else if (!strcmp(argv[2], "ssa")) {ok = ::hill::test::ssa(test_session);}
+				else if (!strcmp(argv[2], "lsp")) {ok = ::hill::test::lsp(test_session);}
 				
 				else {return usage(argv[0]);}
 			} else {
@@ -72,6 +136,8 @@ int main(int argc, char *argv[])
 				if (!::hill::test::evaluator(test_session)) ok = false;
 				if (!::hill::test::json_parser(test_session)) ok = false;
 				if (!::hill::test::llvm(test_session)) ok = false;
+				if (!::hill::test::ssa(test_session)) ok = false;
+				if (!::hill::test::lsp(test_session)) ok = false;
 			}
 			std::cout << '\n';
 			::hill::test::test_report(test_session, std::cout);
@@ -84,6 +150,8 @@ int main(int argc, char *argv[])
 		if (!::hill::test::evaluator(test_session)) ok = false;
 		if (!::hill::test::json_parser(test_session)) ok = false;
 		if (!::hill::test::llvm(test_session)) ok = false;
+		if (!::hill::test::ssa(test_session)) ok = false;
+		if (!::hill::test::lsp(test_session)) ok = false;
 		std::cout << '\n';
 		::hill::test::test_report(test_session, std::cout);
 	}
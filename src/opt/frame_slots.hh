@@ -0,0 +1,124 @@
+#ifndef HILL__OPT__FRAME_SLOTS_HH_INCLUDED
+#define HILL__OPT__FRAME_SLOTS_HH_INCLUDED
+
+#include "../block.hh"
+#include "../instr.hh"
+#include "../type.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
+namespace hill::opt {
+
+	/**
+	 * Lays out the frame of a block again, so bindings never live at the same time share memory.
+	 * Code is straight-line, a binding lives from the COPY that binds it to the last LOAD of it.
+	 * Bindings are placed in the order they are bound, each in the first free gap it fits.
+	 */
+	inline void assign_frame_slots(block &b)
+	{
+		struct binding {
+			size_t ix, size, align; // As laid out by the analyzer
+			size_t def, last_use; // Instruction indices
+			size_t new_ix = 0;
+		};
+
+		std::vector<binding> bindings;
+		std::map<size_t, size_t> by_ix; // Binding of each offset the analyzer handed out
+
+		// A load of any part of a binding keeps it alive
+		auto find = [&](size_t ix) -> binding * {
+			auto it = by_ix.upper_bound(ix);
+			if (it==by_ix.begin()) return nullptr;
+			auto &bd = bindings[std::prev(it)->second];
+			return ix<bd.ix + bd.size ? &bd : nullptr;
+		};
+
+		for (size_t iix=0; iix<b.instrs.size(); ++iix) {
+			const auto &in = b.instrs[iix];
+			if (in.op==op_code::COPY) {
+				if (auto bd = find(in.val.ix)) {
+					bd->last_use = iix;
+					continue;
+				}
+				by_ix.emplace(in.val.ix, bindings.size());
+				bindings.push_back(binding{
+					.ix = in.val.ix,
+					.size = in.res_type.mem_size(),
+					.align = in.res_type.mem_align(),
+					.def = iix,
+					.last_use = iix});
+			} else if (in.op==op_code::LOAD) {
+				if (auto bd = find(in.val.ix)) bd->last_use = iix;
+			}
+		}
+
+		// Free gaps in the new frame by offset, and the bindings holding memory by when they die
+		std::map<size_t, size_t> gaps;
+		std::multimap<size_t, const binding *> live;
+		size_t frame_size = 0;
+
+		auto release = [&](const binding &bd) {
+			auto [it, added] = gaps.emplace(bd.new_ix, bd.size);
+			auto next = std::next(it);
+			if (next!=gaps.end() && it->first + it->second==next->first) {
+				it->second += next->second;
+				gaps.erase(next);
+			}
+			if (it!=gaps.begin()) {
+				auto prev = std::prev(it);
+				if (prev->first + prev->second==it->first) {
+					prev->second += it->second;
+					gaps.erase(it);
+				}
+			}
+		};
+
+		auto place = [&](size_t size, size_t align) {
+			for (auto it=gaps.begin(); it!=gaps.end(); ++it) {
+				auto [gap_ix, gap_size] = *it;
+				auto ix = align_up(gap_ix, align);
+				if (ix + size>gap_ix + gap_size) continue;
+
+				// What is left on either side stays free
+				gaps.erase(it);
+				if (ix>gap_ix) gaps.emplace(gap_ix, ix - gap_ix);
+				if (ix + size<gap_ix + gap_size) gaps.emplace(ix + size, gap_ix + gap_size - ix - size);
+				return ix;
+			}
+
+			auto ix = align_up(frame_size, align);
+			if (ix>frame_size) release(binding{.ix = 0, .size = ix - frame_size, .align = 1, .def = 0, .last_use = 0, .new_ix = frame_size});
+			frame_size = ix + size;
+			return ix;
+		};
+
+		for (auto &bd : bindings) {
+			while (!live.empty() && live.begin()->first<bd.def) {
+				release(*live.begin()->second);
+				live.erase(live.begin());
+			}
+			bd.new_ix = place(bd.size, bd.align);
+			live.emplace(bd.last_use, &bd);
+		}
+
+		auto move = [&](size_t &ix) {
+			if (auto bd = find(ix)) ix = bd->new_ix + (ix - bd->ix);
+		};
+
+		for (auto &in : b.instrs) {
+			if (in.op==op_code::COPY || in.op==op_code::LOAD) move(in.val.ix);
+		}
+		for (auto &[name, vals] : b.s.ids) {
+			for (auto &val : vals) {
+				if (val.mt==mem_type::STACK) move(val.ix);
+			}
+		}
+
+		b.s.frame.ix = frame_size;
+	}
+}
+
+#endif /* HILL__OPT__FRAME_SLOTS_HH_INCLUDED */
@@ -0,0 +1,113 @@
+#ifndef HILL__OPT__SSA_PASSES_HH_INCLUDED
+#define HILL__OPT__SSA_PASSES_HH_INCLUDED
+
+#include "../ssa.hh"
+
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hill::opt {
+
+	/**
+	 * Register each register is replaced with, itself unless a pass found another one holding the same value
+	 */
+	struct reg_map {
+		explicit reg_map(const ssa::function &f): to(f.regs.size())
+		{
+			std::iota(to.begin(), to.end(), 0);
+		}
+
+		void rewrite(ssa::instr &in) const
+		{
+			in.for_each_use([&](ssa::reg &r) {r = to[r];});
+		}
+
+		std::vector<ssa::reg> to;
+	};
+
+	/**
+	 * Uses of a MOV become uses of what it copies, the MOV itself is left for dead code elimination.
+	 * A MOV to another type stays, its uses need the value seen as that type.
+	 */
+	inline void propagate_copies(ssa::function &f)
+	{
+		reg_map map(f);
+		for (auto &block : f.blocks) {
+			for (auto &in : block.instrs) {
+				map.rewrite(in);
+				if (in.op==ssa::op_code::MOV && f.regs[in.res]==f.regs[in.args[0]]) map.to[in.res] = in.args[0];
+			}
+		}
+		f.result = map.to[f.result];
+	}
+
+	/**
+	 * Instructions doing what an earlier one did on the same registers use its result instead.
+	 * Only calls of pure functions are shared, any other builtin may have side effects.
+	 */
+	inline void eliminate_common_subexpressions(ssa::function &f)
+	{
+		reg_map map(f);
+		std::unordered_map<std::string, ssa::reg> seen;
+
+		for (auto &block : f.blocks) {
+			for (auto &in : block.instrs) {
+				map.rewrite(in);
+				if (in.op==ssa::op_code::CALL && !in.pure) continue;
+
+				auto add = [](std::string &key, const auto &v) {key.append((const char *)&v, sizeof v);};
+				std::string key;
+				add(key, in.op);
+				add(key, f.regs[in.res].id);
+				add(key, in.args);
+				for (const auto &p : in.parts) {
+					add(key, p.src);
+					add(key, p.src_offset);
+					add(key, p.offset);
+					add(key, p.size);
+				}
+				if (in.op==ssa::op_code::CONST) {
+					key.append(std::string_view((const char *)f.consts.data() + in.const_ix, f.regs[in.res].mem_size()));
+				}
+
+				auto [it, added] = seen.try_emplace(std::move(key), in.res);
+				if (!added) map.to[in.res] = it->second;
+			}
+		}
+		f.result = map.to[f.result];
+	}
+
+	/**
+	 * Removes instructions whose result is never used, calls of functions that are not pure are kept
+	 */
+	inline void eliminate_dead_code(ssa::function &f)
+	{
+		std::vector<bool> used(f.regs.size());
+		used[f.result] = true;
+
+		auto is_dead = [&](const ssa::instr &in) {
+			return !used[in.res] && (in.op!=ssa::op_code::CALL || in.pure);
+		};
+
+		for (auto bit=f.blocks.rbegin(); bit!=f.blocks.rend(); ++bit) {
+			auto &instrs = bit->instrs;
+			for (auto it=instrs.rbegin(); it!=instrs.rend(); ++it) {
+				if (is_dead(*it)) continue;
+				it->for_each_use([&](ssa::reg &r) {used[r] = true;});
+			}
+			std::erase_if(instrs, is_dead);
+		}
+	}
+
+	inline void optimize(ssa::function &f)
+	{
+		propagate_copies(f);
+		eliminate_common_subexpressions(f);
+		eliminate_dead_code(f);
+	}
+}
+
+#endif /* HILL__OPT__SSA_PASSES_HH_INCLUDED */
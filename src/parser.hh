@@ -1,6 +1,9 @@
 #ifndef HILL__PARSER_HH_INCLUDED
 #define HILL__PARSER_HH_INCLUDED
 
+#include "exceptions.hh"
+#include "utils/cancellation_token.hh"
+
 #include <memory>
 #include <istream>
 #include <iostream>
@@ -52,6 +55,7 @@ namespace hill {
 					put_token(pop_mv(op_stack));
 				}
 				// TODO: Consider checking if grouping tokens matches in token type
+				if (op_stack.empty()) throw syntax_error_exception(error_code::UNBALANCED_GROUP);
 				op_stack.pop();
 				put_token(std::move(t));
 			} else if (t.op()) {
@@ -83,11 +87,11 @@ namespace hill {
 
 		void error_token(token t)
 		{
-			std::cerr << "ERROR: " << t.str() << '\n';
-			std::exit(EXIT_FAILURE); // TODO: Handle errors properly
+			(void)t; // Unused
+			throw syntax_error_exception(error_code::UNEXPECTED_TOKEN);
 		}
 
-		template<typename LT> void parse(std::istream &istr, LT &lexer)
+		template<typename LT> void parse(std::istream &istr, LT &lexer, const utils::cancellation_token &cancellation = {})
 		{
 			token_queue queue;
 
@@ -95,6 +99,8 @@ namespace hill {
 			token t;
 
 			while (!(t = queue.pull_token(istr, lexer)).end()) {
+				cancellation.throw_if_cancelled();
+
 				if (t.error()) {
 					throw internal_exception();
 				}
@@ -127,7 +133,15 @@ namespace hill {
 					} else {
 						prev_t = t.clone();
 
-						if (t.has_arity(tt_arity::LUNARY)) {
+						if (t.get_type()==tt::OP_MINUS && next_t->get_type()==tt::NUM && next_t->lix==t.lix && next_t->cix==t.cix+1
+								&& next_t->get_text().find_first_not_of("0123456789.'")!=std::string::npos) {
+							// A minus right before a literal with a suffix is its sign, -128i8 would not fit negated later
+							auto num = queue.pull_token(istr, lexer);
+							auto nt = token(tt::NUM, "-" + num.get_text(), t.lix, t.cix);
+							prev_t = nt.clone();
+							nt.select_op_spec(tt_arity::NULLARY);
+							parse_token(std::move(nt));
+						} else if (t.has_arity(tt_arity::LUNARY)) {
 							t.select_op_spec(tt_arity::LUNARY);
 							parse_token(std::move(t));
 						} else error_token(std::move(t));
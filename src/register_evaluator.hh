@@ -0,0 +1,176 @@
+#ifndef HILL__REGISTER_EVALUATOR_HH_INCLUDED
+#define HILL__REGISTER_EVALUATOR_HH_INCLUDED
+
+#include "evaluator.hh"
+#include "ssa.hh"
+#include "value.hh"
+#include "opt/ssa_passes.hh"
+
+#include <functional>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+namespace hill {
+
+	/**
+	 * Runs the SSA form of a block, every register at a fixed offset in one block of memory.
+	 * Constants are in that memory from the start, the other instructions are each a call to a kernel
+	 * picked for their types when the function is compiled, so nothing is pushed or popped.
+	 */
+	struct register_evaluator {
+		register_evaluator() = default;
+
+		value evaluate(const block &b)
+		{
+			auto f = ssa::lower(b);
+			opt::optimize(f);
+			return run(f);
+		}
+
+		value run(const ssa::function &f)
+		{
+			auto p = compile(f);
+
+			auto regs = p.image;
+			for (const auto &in : p.code) in.fn(regs.data(), in);
+			return value(f.regs[f.result], regs.data() + p.offsets[f.result]);
+		}
+
+	private:
+		struct vm_part {
+			uint32_t src, dst, size;
+		};
+
+		struct vm_instr {
+			void (*fn)(uint8_t *regs, const vm_instr &in);
+			uint32_t res, a = 0, b = 0; // Register offsets
+			convert_func convert = nullptr;
+			size_t cnt = 1;
+			std::vector<vm_part> parts = {};
+		};
+
+		struct program {
+			std::vector<uint32_t> offsets; // Of each register
+			std::vector<uint8_t> image; // Registers as they are before running, constants filled in
+			std::vector<vm_instr> code;
+		};
+
+		typedef void (*ifunc)(uint8_t *, uint8_t *);
+
+		template<typename T, typename OP> static void arith(uint8_t *regs, const vm_instr &in)
+		{
+			if constexpr (std::is_same_v<OP, std::negate<T>>) {
+				store_value(regs + in.res, static_cast<T>(OP()(load_value<T>(regs + in.a))));
+			} else {
+				store_value(regs + in.res, static_cast<T>(OP()(load_value<T>(regs + in.a), load_value<T>(regs + in.b))));
+			}
+		}
+
+		template<template<typename> typename OP> static auto arith_fn(basic_type bt)
+		{
+			switch (bt) {
+			case basic_type::I8: return &arith<int8_t, OP<int8_t>>;
+			case basic_type::I16: return &arith<int16_t, OP<int16_t>>;
+			case basic_type::I32: return &arith<int32_t, OP<int32_t>>;
+			case basic_type::I64:
+			case basic_type::I: return &arith<int64_t, OP<int64_t>>;
+			case basic_type::U8: return &arith<uint8_t, OP<uint8_t>>;
+			case basic_type::U16: return &arith<uint16_t, OP<uint16_t>>;
+			case basic_type::U32: return &arith<uint32_t, OP<uint32_t>>;
+			case basic_type::U64:
+			case basic_type::U: return &arith<uint64_t, OP<uint64_t>>;
+			case basic_type::F32: return &arith<float, OP<float>>;
+			case basic_type::F64:
+			case basic_type::F: return &arith<double, OP<double>>;
+			default: throw internal_exception();
+			}
+		}
+
+		static void mov(uint8_t *regs, const vm_instr &in)
+		{
+			memcpy(regs + in.res, regs + in.a, in.cnt);
+		}
+
+		static void convert(uint8_t *regs, const vm_instr &in)
+		{
+			in.convert(regs + in.res, regs + in.a);
+		}
+
+		static void copy_parts(uint8_t *regs, const vm_instr &in)
+		{
+			for (const auto &p : in.parts) memcpy(regs + p.dst, regs + p.src, p.size);
+		}
+
+		static void call(uint8_t *regs, const vm_instr &in)
+		{
+			load_value<ifunc>(regs + in.a)(regs + in.res, regs + in.b);
+		}
+
+		static program compile(const ssa::function &f)
+		{
+			program p;
+
+			size_t end = 0;
+			for (const auto &t : f.regs) {
+				auto ix = align_up(end, t.mem_align());
+				p.offsets.push_back((uint32_t)ix);
+				end = ix + t.mem_size();
+			}
+			p.image.resize(end);
+
+			for (const auto &block : f.blocks) {
+				for (const auto &in : block.instrs) {
+					const auto &t = f.regs[in.res];
+					auto vin = vm_instr{.fn = nullptr, .res = p.offsets[in.res]};
+					if (in.args[0]!=ssa::NO_REG) vin.a = p.offsets[in.args[0]];
+					if (in.args[1]!=ssa::NO_REG) vin.b = p.offsets[in.args[1]];
+
+					switch (in.op) {
+					case ssa::op_code::CONST:
+						memcpy(p.image.data() + vin.res, f.consts.data() + in.const_ix, t.mem_size());
+						continue;
+					case ssa::op_code::MOV:
+						vin.fn = &mov;
+						vin.cnt = t.mem_size();
+						break;
+					case ssa::op_code::ADD: vin.fn = arith_fn<std::plus>(t.first()); break;
+					case ssa::op_code::SUB: vin.fn = arith_fn<std::minus>(t.first()); break;
+					case ssa::op_code::MUL: vin.fn = arith_fn<std::multiplies>(t.first()); break;
+					case ssa::op_code::NEG:
+						// Like the stack evaluator, unsigned numbers cannot be negated
+						if (is_unsigned_int_type(t.first())) throw internal_exception();
+						vin.fn = arith_fn<std::negate>(t.first());
+						break;
+					case ssa::op_code::CONVERT:
+						vin.fn = &convert;
+						vin.convert = convert_funcs[(size_t)f.regs[in.args[0]].first()][(size_t)t.first()];
+						if (!vin.convert) throw internal_exception();
+						break;
+					case ssa::op_code::TUPLE:
+					case ssa::op_code::EXTRACT:
+						vin.fn = &copy_parts;
+						for (const auto &part : in.parts) {
+							vin.parts.push_back(vm_part{
+								.src = p.offsets[part.src] + (uint32_t)part.src_offset,
+								.dst = vin.res + (uint32_t)part.offset,
+								.size = (uint32_t)part.size});
+						}
+						break;
+					case ssa::op_code::CALL:
+						vin.fn = &call;
+						break;
+					default:
+						throw internal_exception();
+					}
+					p.code.push_back(std::move(vin));
+				}
+			}
+
+			return p;
+		}
+	};
+}
+
+#endif /* HILL__REGISTER_EVALUATOR_HH_INCLUDED */
@@ -0,0 +1,297 @@
+#ifndef HILL__SSA_HH_INCLUDED
+#define HILL__SSA_HH_INCLUDED
+
+#include "block.hh"
+#include "exceptions.hh"
+#include "instr.hh"
+#include "type.hh"
+
+#include <array>
+#include <map>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+namespace hill::ssa {
+
+	typedef uint32_t reg;
+	constexpr reg NO_REG = UINT32_MAX;
+
+	enum class op_code {
+		CONST, // Value from the constant data
+		MOV, // The value of another register, seen as another type with the same layout if the types differ
+		ADD, // Arithmetic addition
+		SUB, // Arithmetic subtraction
+		MUL, // Arithmetic multiplication
+		NEG, // Arithmetic negation
+		CONVERT, // Number to another number type
+		TUPLE, // Tuple put together from parts of other registers
+		EXTRACT, // Part of another register, like a tuple element
+		CALL, // Builtin function in args[0] called with args[1]
+	};
+
+	inline const char *op_code_str(op_code op)
+	{
+		switch (op) {
+		case op_code::CONST: return "CONST";
+		case op_code::MOV: return "MOV";
+		case op_code::ADD: return "ADD";
+		case op_code::SUB: return "SUB";
+		case op_code::MUL: return "MUL";
+		case op_code::NEG: return "NEG";
+		case op_code::CONVERT: return "CONVERT";
+		case op_code::TUPLE: return "TUPLE";
+		case op_code::EXTRACT: return "EXTRACT";
+		case op_code::CALL: return "CALL";
+		default: throw internal_exception();
+		}
+	}
+
+	/**
+	 * Bytes of a register copied into the result, at offset in it
+	 */
+	struct part {
+		reg src;
+		size_t src_offset, offset, size;
+	};
+
+	struct instr {
+		op_code op;
+		reg res;
+		std::array<reg, 2> args = {NO_REG, NO_REG};
+		size_t const_ix = 0; // CONST
+		std::vector<part> parts = {}; // TUPLE and EXTRACT
+		bool pure = false; // CALL of a function without side effects
+
+		template<typename FN> void for_each_use(FN fn)
+		{
+			for (auto &arg : args) {
+				if (arg!=NO_REG) fn(arg);
+			}
+			for (auto &p : parts) fn(p.src);
+		}
+	};
+
+	struct basic_block {
+		std::vector<instr> instrs;
+	};
+
+	/**
+	 * Code of a block with every value in a register of its own, written by exactly one instruction.
+	 * Nothing in the language branches yet, so there is a single basic block and it ends with the result.
+	 */
+	struct function {
+		std::vector<type> regs; // Type of each register
+		std::vector<uint8_t> consts;
+		std::vector<basic_block> blocks;
+		reg result = NO_REG;
+
+		reg add_reg(const type &t)
+		{
+			regs.push_back(t);
+			return (reg)(regs.size()-1);
+		}
+
+		size_t add_const(const void *p, size_t size, size_t align)
+		{
+			auto ix = align_up(consts.size(), align);
+			consts.resize(ix + size);
+			memcpy(consts.data() + ix, p, size);
+			return ix;
+		}
+
+		size_t instr_count() const
+		{
+			size_t cnt = 0;
+			for (const auto &block : blocks) cnt += block.instrs.size();
+			return cnt;
+		}
+
+		std::string to_str() const
+		{
+			std::stringstream ss;
+			for (size_t bix=0; bix<blocks.size(); ++bix) {
+				ss << "b" << bix << ":\n";
+				for (const auto &in : blocks[bix].instrs) {
+					ss << "  r" << in.res << " = " << op_code_str(in.op) << ' ' << regs[in.res].to_str();
+					for (auto arg : in.args) {
+						if (arg!=NO_REG) ss << " r" << arg;
+					}
+					for (const auto &p : in.parts) ss << " r" << p.src << '[' << p.src_offset << ',' << p.size << "]@" << p.offset;
+					if (in.op==op_code::CONST) ss << " #" << in.const_ix;
+					if (in.pure) ss << " pure";
+					ss << '\n';
+				}
+			}
+			ss << "  return r" << result << '\n';
+			return ss.str();
+		}
+	};
+
+	/**
+	 * Parts of a tuple made of left and right, flattened into the elements of left if it is still open
+	 */
+	inline std::vector<part> tuple_parts(const function &f, const type &res_type, reg left, reg right)
+	{
+		const auto &elms = res_type.desc().elms;
+		const auto &ltype = f.regs[left];
+		std::vector<part> parts;
+
+		if (ltype.first()==basic_type::TUPLE && elms.size()==ltype.num_elms()+1) {
+			const auto &lelms = ltype.desc().elms;
+			for (size_t ix=0; ix<lelms.size(); ++ix) {
+				parts.push_back(part{.src = left, .src_offset = lelms[ix].mem_offset, .offset = elms[ix].mem_offset,
+					.size = type::from_id(lelms[ix].id).mem_size()});
+			}
+		} else if (elms.size()==2) {
+			parts.push_back(part{.src = left, .src_offset = 0, .offset = elms[0].mem_offset, .size = ltype.mem_size()});
+		} else {
+			throw internal_exception();
+		}
+		parts.push_back(part{.src = right, .src_offset = 0, .offset = elms.back().mem_offset, .size = f.regs[right].mem_size()});
+		return parts;
+	}
+
+	/**
+	 * Translates the stack machine code of a block, following its stack with registers.
+	 * Bindings live in registers instead of the frame, a LOAD is the register of the last COPY to its offset.
+	 */
+	inline function lower(const block &b)
+	{
+		function f;
+		f.blocks.emplace_back();
+		auto &code = f.blocks.back().instrs;
+
+		std::vector<reg> stack;
+		std::map<size_t, reg> locals; // By frame offset
+
+		auto pop = [&]() {
+			if (stack.empty()) throw internal_exception();
+			auto r = stack.back();
+			stack.pop_back();
+			return r;
+		};
+		auto push = [&](const ::hill::instr &in, reg r) {
+			// Piping places the function under its first argument
+			if (in.offset<0) {
+				if (stack.empty()) throw internal_exception();
+				stack.insert(stack.end()-1, r);
+			} else {
+				stack.push_back(r);
+			}
+		};
+		auto emit = [&](op_code op, const type &t, reg arg1=NO_REG, reg arg2=NO_REG) {
+			auto r = f.add_reg(t);
+			code.push_back(instr{.op = op, .res = r, .args = {arg1, arg2}});
+			return r;
+		};
+		// An array is put together as a tuple of its elements and only then seen as an array
+		auto as = [&](reg r, const type &t) {
+			if (t.types().empty() || f.regs[r]==t) return r;
+			if (f.regs[r].mem_size()!=t.mem_size()) throw internal_exception();
+			return emit(op_code::MOV, t, r);
+		};
+		auto pop_as = [&](const type &t) {return as(pop(), t);};
+		auto emit_const = [&](const type &t, const void *p) {
+			auto r = emit(op_code::CONST, t);
+			code.back().const_ix = f.add_const(p, t.mem_size(), t.mem_align());
+			return r;
+		};
+		auto emit_tuple = [&](const type &t, reg left, reg right) {
+			auto parts = tuple_parts(f, t, left, right);
+			auto r = emit(op_code::TUPLE, t);
+			code.back().parts = std::move(parts);
+			return r;
+		};
+
+		for (const auto &in : b.instrs) {
+			switch (in.op) {
+			case ::hill::op_code::END:
+				if (stack.empty()) throw internal_exception();
+				f.result = as(stack.back(), in.res_type);
+				break;
+			case ::hill::op_code::LOAD:
+				{
+					auto it = locals.find(in.val.ix);
+					if (it==locals.end()) throw internal_exception();
+					push(in, it->second);
+				}
+				break;
+			case ::hill::op_code::LOADL:
+				if (in.val.ix + in.res_type.mem_size()>b.values.mem.size()) throw internal_exception();
+				push(in, emit_const(in.res_type, b.values.mem.data() + in.val.ix));
+				break;
+			case ::hill::op_code::LOADI:
+				push(in, emit_const(in.res_type, &in.val));
+				break;
+			case ::hill::op_code::COPY:
+				{
+					auto r = emit(op_code::MOV, in.res_type, pop_as(in.arg2_type));
+					locals[in.val.ix] = r;
+					push(in, r);
+				}
+				break;
+			case ::hill::op_code::ADD:
+			case ::hill::op_code::SUB:
+			case ::hill::op_code::MUL:
+				{
+					auto op = in.op==::hill::op_code::ADD ? op_code::ADD : in.op==::hill::op_code::SUB ? op_code::SUB : op_code::MUL;
+					auto right = pop_as(in.arg2_type);
+					auto left = pop_as(in.arg1_type);
+					push(in, emit(op, in.res_type, left, right));
+				}
+				break;
+			case ::hill::op_code::NEG:
+				push(in, emit(op_code::NEG, in.res_type, pop_as(in.arg1_type)));
+				break;
+			case ::hill::op_code::CONVERT:
+				if (in.val.ix) {
+					// The value is under the right operand
+					auto above = pop();
+					push(in, emit(op_code::CONVERT, in.res_type, pop_as(in.arg1_type)));
+					stack.push_back(above);
+				} else {
+					push(in, emit(op_code::CONVERT, in.res_type, pop_as(in.arg1_type)));
+				}
+				break;
+			case ::hill::op_code::TUPLE:
+				{
+					auto right = pop_as(in.arg2_type);
+					auto left = pop_as(in.arg1_type);
+					push(in, emit_tuple(in.res_type, left, right));
+				}
+				break;
+			case ::hill::op_code::TUPLE_ELM:
+				{
+					auto tuple = pop_as(in.arg1_type);
+					auto r = emit(op_code::EXTRACT, in.res_type);
+					code.back().parts.push_back(part{.src = tuple, .src_offset = in.arg1_type.mem_size() - in.val.ix, .offset = 0,
+						.size = in.res_type.mem_size()});
+					push(in, r);
+				}
+				break;
+			case ::hill::op_code::CALL:
+				{
+					// A piped value and the rest of the argument are still apart
+					auto arg = pop();
+					if (f.regs[arg]!=in.arg2_type) arg = emit_tuple(in.arg2_type, pop(), arg);
+					auto func = pop_as(in.arg1_type);
+					push(in, emit(op_code::CALL, in.res_type, func, arg));
+					code.back().pure = in.arg1_type.is_pure_func;
+				}
+				break;
+			case ::hill::op_code::ID:
+				break; // Names bound or looked up, they leave nothing on the stack
+			default:
+				throw not_implemented_exception();
+			}
+		}
+
+		if (f.result==NO_REG) throw internal_exception();
+		return f;
+	}
+}
+
+#endif /* HILL__SSA_HH_INCLUDED */
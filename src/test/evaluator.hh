@@ -6,6 +6,7 @@
 #include "../analyzer.hh"
 #include "../evaluator.hh"
 #include "../hill.hh"
+#include "../register_evaluator.hh"
 #include "../utils/console.hh"
 
 #include "./support.hh"
@@ -43,26 +44,69 @@ namespace hill::test {
 		{"the_answer", "@i32", "42", error_code::NO_ERROR},
 		{"2 |> pow 16", "@i32", "65536", error_code::NO_ERROR},
 		{"2 |> pow 8 |> pow 2", "@i32", "65536", error_code::NO_ERROR},
+		{"2.0 |> pow 3.0", "@f64", "8.0", error_code::NO_ERROR},
+		{"pow (2, 3.0)", "", "", error_code::UNDEFINED_ID},
 		{"3 |> pow 2 |> div 3 |> pow 3", "@i32", "27", error_code::NO_ERROR},
+		{"div (1, 0)", "", "", error_code::DIVISION_BY_ZERO},
+		{"(div (1, 0), 2)", "", "", error_code::DIVISION_BY_ZERO},
+		{"pow (2, 3) + pow (2, 3)", "@i32", "16", error_code::NO_ERROR},
+		{"(abs (-2) * abs (-2), 2 |> pow 3)", "(@i32,@i32)", "(4,8)", error_code::NO_ERROR},
 		{"[1, 2]", "@array(@i32,2)", "[1,2]", error_code::NO_ERROR},
 		{"[1.0, 2.0]", "@array(@f64,2)", "[1.0,2.0]", error_code::NO_ERROR},
 		{"[1]", "@array(@i32,1)", "[1]", error_code::NO_ERROR},
 		{"[(1,2),(3,4)]", "@array((@i32,@i32),2)", "[(1,2),(3,4)]", error_code::NO_ERROR},
 		{"[(1.0,2),(3.0,4),(5.0,6)]", "@array((@f64,@i32),3)", "[(1.0,2),(3.0,4),(5.0,6)]", error_code::NO_ERROR},
 		{"[(1.0,2),(3.0,4),(5.0,6.0)]", "", "", error_code::ARRAY_ELM_TYPE_MISMATCH},
+		{"(1,2)._2", "", "", error_code::UNKNOWN_MEMBER_NAME},
+		{"(a := 1, a + 2)", "(@i32,@i32)", "(1,3)", error_code::NO_ERROR},
+		{"(a := 1, b := 2, a + b)", "(@i32,@i32,@i32)", "(1,2,3)", error_code::NO_ERROR},
+		{"(1,2.5)", "(@i32,@f64)", "(1,2.5)", error_code::NO_ERROR},
+		{"(1.5,2,3)", "(@f64,@i32,@i32)", "(1.5,2,3)", error_code::NO_ERROR},
+		{"(1,(2.5,3))", "(@i32,(@f64,@i32))", "(1,(2.5,3))", error_code::NO_ERROR},
+		{"((1,2.5),3)", "((@i32,@f64),@i32)", "((1,2.5),3)", error_code::NO_ERROR},
+		{"[(1,2.5),(3,4.5)]", "@array((@i32,@f64),2)", "[(1,2.5),(3,4.5)]", error_code::NO_ERROR},
+		{"100'000", "@i32", "100000", error_code::NO_ERROR},
+		{"3'000'000'000", "@i64", "3000000000", error_code::NO_ERROR},
+		{"100'000L", "@i64", "100000", error_code::NO_ERROR},
+		{"2.5f", "@f32", "2.5", error_code::NO_ERROR},
+		{"200u8 + 50u8", "@u8", "250", error_code::NO_ERROR},
+		{"[1i16, 2i16]", "@array(@i16,2)", "[1,2]", error_code::NO_ERROR},
+		{"(1u, 2.5f64)", "(@u32,@f64)", "(1,2.5)", error_code::NO_ERROR},
+		{"300u8", "", "", error_code::INVALID_NUMBER_LITERAL},
+		{"1.5i32", "", "", error_code::INVALID_NUMBER_LITERAL},
+		{"1x", "", "", error_code::INVALID_NUMBER_LITERAL},
+		{"-128i8", "@i8", "-128", error_code::NO_ERROR},
+		{"-32768i16", "@i16", "-32768", error_code::NO_ERROR},
+		{"2 - -2.5f", "@f32", "4.5", error_code::NO_ERROR},
+		{"-1u8", "@u8", "255", error_code::NO_ERROR},
+		{"-129i8", "", "", error_code::INVALID_NUMBER_LITERAL},
+		{"-(128i8)", "", "", error_code::INVALID_NUMBER_LITERAL},
+		{"127i8 + 1i8", "@i8", "-128", error_code::NO_ERROR},
+		{"1 + 2.5", "@f64", "3.5", error_code::NO_ERROR},
+		{"2.5 * 2", "@f64", "5.0", error_code::NO_ERROR},
+		{"2.5f * 2", "@f32", "5.0", error_code::NO_ERROR},
+		{"1u8 + 1000", "@i32", "1001", error_code::NO_ERROR},
+		{"1u32 - 2", "@u32", "4294967295", error_code::NO_ERROR},
+		{"3'000'000'000 - 1i8", "@i64", "2999999999", error_code::NO_ERROR},
+		{"(1 + 0.5f64, 2i16 * 3)", "(@f64,@i32)", "(1.5,6)", error_code::NO_ERROR},
+		{"[1i8,2i8] * 3", "", "", error_code::ARITH_TYPE_MISMATCH},
+		{"[1.5f, 2.5f] * 2", "", "", error_code::ARITH_TYPE_MISMATCH},
+		{"[1,2] * 3", "", "", error_code::ARITH_TYPE_MISMATCH},
+		{"[1,2] + [3,4]", "", "", error_code::ARITH_TYPE_MISMATCH},
+		{"(1,2) - 1", "", "", error_code::ARITH_TYPE_MISMATCH},
+		{"(a := 1, b := a, c := 2.5, d := c, b + d)", "(@i32,@i32,@f64,@f64,@f64)", "(1,1,2.5,2.5,3.5)", error_code::NO_ERROR},
+		{"(a := 1i8, b := 2.5, c := 3i16, d := a, (b, c, d))", "(@i8,@f64,@i16,@i8,(@f64,@i16,@i8))", "(1,2.5,3,1,(2.5,3,1))", error_code::NO_ERROR},
 		//{"a:=1;a=2", "@i32", "2", error_code::NO_ERROR},
 		//{"a:=1;a=a+2", "@i32", "3", error_code::NO_ERROR},
 		//{"a:=1;b:=10;a=a+2", "@i32", "3", error_code::NO_ERROR},
 	};
 
-	inline bool evaluator(utils::junit_session &test_session)
+	template<typename ET> bool run_evaluator_tests(utils::junit_session &test_session, const char *suite_name)
 	{
-		auto suite = test_session.add_suite("Test.Evaluator");
+		auto suite = test_session.add_suite(suite_name);
 
 		bool ok = true;
 
-		std::cout << "Evaluator testing:\n";
-
 		for (size_t ix=0; ix<sizeof evaluator_tests/sizeof evaluator_tests[0]; ++ix) {
 			utils::timer timer;
 			auto src_ss = get_src(evaluator_tests[ix].src);
@@ -78,7 +122,7 @@ namespace hill::test {
 			::hill::lexer l;
 			::hill::parser p;
 			::hill::analyzer a;
-			::hill::evaluator e;
+			ET e;
 
 			::hill::value val;
 			error_code ec = error_code::NO_ERROR;
@@ -123,6 +167,20 @@ namespace hill::test {
 
 		return ok;
 	}
+
+	/**
+	 * The same tests on the stack machine and on the register machine
+	 */
+	inline bool evaluator(utils::junit_session &test_session)
+	{
+		std::cout << "Evaluator testing:\n";
+		bool ok = run_evaluator_tests<::hill::evaluator>(test_session, "Test.Evaluator");
+
+		std::cout << "Register evaluator testing:\n";
+		if (!run_evaluator_tests<::hill::register_evaluator>(test_session, "Test.RegisterEvaluator")) ok = false;
+
+		return ok;
+	}
 }
 
 #endif /* HILL__TEST__EVALUATOR_HH_INCLUDED */
@@ -17,6 +17,7 @@ namespace hill::test {
 		{"a", "1:1:NAME(a)"},
 		{"2 + 3", "1:1:NUM(2),1:2:WHITESPACE( ),1:3:OP_PLUS(+),1:4:WHITESPACE( ),1:5:NUM(3)"},
 		{"\n1", "1:1:WHITESPACE(\n),2:1:NUM(1)"},
+		{"1i16+2", "1:1:NUM(1i16),1:5:OP_PLUS(+),1:6:NUM(2)"},
 		{":tests/lexer-mess.hill", ":tests/lexer-mess.exp"},
 	};
 
@@ -1,27 +1,85 @@
 #ifndef HILL__TEST__LLVM_HH_INCLUDED
 #define HILL__TEST__LLVM_HH_INCLUDED
 
+#include "../lexer.hh"
+#include "../parser.hh"
+#include "../analyzer.hh"
+#include "../hill.hh"
+#include "../ssa.hh"
+#include "../opt/ssa_passes.hh"
+#include "../llvm/from_ssa.hh"
 #include "../llvm/marshal.hh"
+#include "../utils/console.hh"
 
 #include "./support.hh"
 
+#include <fstream>
 #include <memory>
+#include <sstream>
 
 namespace hill::test {
 
+	struct {
+		const char *src;
+		const char *expected; // Body of the function, one instruction after another
+	} llvm_tests[]={
+		{"1", "ret i32 1"},
+		{"1 + 2 * 3", "%r3 = mul i32 2, 3; %r4 = add i32 1, %r3; ret i32 %r4"},
+		{"1 + 2 * 3.5", "%r3 = sitofp i32 2 to double; %r4 = fmul double %r3, 0x400C000000000000; %r5 = sitofp i32 1 to double; %r6 = fadd double %r5, %r4; ret double %r6"},
+		{"-(2i8 * 3u16)", "%r2 = sext i8 2 to i16; %r3 = mul i16 %r2, 3; %r4 = sub i16 0, %r3; ret i16 %r4"},
+		{"(1, 2)", "-1"}, // Only numbers so far
+	};
+
 	inline bool llvm(utils::junit_session &test_session)
 	{
 		auto suite = test_session.add_suite("Test.LLVM");
-		(void)suite;
 
-		std::ofstream ofstr("tmp/llvm_test.ll", std::ios::out | std::ios::binary);
+		bool ok = true;
+
+		std::cout << "LLVM testing:\n";
 
 		auto tu = std::make_shared<llvm::translation_unit>();
 		tu->source_filename = "llvm_test.hill";
 
+		for (size_t ix=0; ix<sizeof llvm_tests/sizeof llvm_tests[0]; ++ix) {
+			utils::timer timer;
+			auto src_ss = get_src(llvm_tests[ix].src);
+
+			std::stringstream ss;
+			try {
+				::hill::lexer l;
+				::hill::parser p;
+				::hill::analyzer a;
+				p.parse(src_ss, l);
+				a.set_trunk(build_lib(build_root()));
+				a.analyze(p.get_rpn());
+				a.optimize();
+
+				auto f = ssa::lower(a.get_main_block());
+				opt::optimize(f);
+				auto func = llvm::translate(f, "f" + std::to_string(ix));
+
+				for (size_t lix=0; lix<func.body.size(); ++lix) {
+					if (lix>0) ss << "; ";
+					ss << func.body[lix];
+				}
+				tu->functions.push_back(std::move(func));
+			} catch (::hill::exception &ex) {
+				ss << error_code_to_str(ex.get_error_code());
+			}
+
+			std::cout << " Test " << test(
+				suite, timer.elapsed_sec(),
+				llvm_tests[ix].src,
+				llvm_tests[ix].expected,
+				ss.str().c_str(),
+				&ok);
+		}
+
+		std::ofstream ofstr("tmp/llvm_test.ll", std::ios::out | std::ios::binary);
 		llvm::marshal_ir(tu, ofstr);
 
-		return true;
+		return ok;
 	}
 }
 
@@ -0,0 +1,339 @@
+#ifndef HILL__TEST__LSP_HH_INCLUDED
+#define HILL__TEST__LSP_HH_INCLUDED
+
+#include "../lsp/analysis.hh"
+#include "../lsp/document_store.hh"
+#include "../lsp/methods/workspace/diagnostic.hh"
+#include "../lsp/semantic_tokens.hh"
+#include "../lsp/server_state.hh"
+#include "../lsp/writer.hh"
+#include "../utils/json_parser.hh"
+#include "../utils/junit.hh"
+
+#include "./support.hh"
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace hill::test {
+
+	struct {
+		const char *name;
+		size_t docs;
+		bool partial;
+		const char *expected; // Reports in the response, then in each $/progress
+	} workspace_diagnostic_tests[]={
+		{"Without a partial result token", 70, false, "70"},
+		{"Partial results, fewer than a batch", 10, true, "10"},
+		{"Partial results, more than a batch", 70, true, "0,64,6"},
+		{"Partial results, whole batches", 128, true, "0,64,64"},
+	};
+
+	inline size_t json_items_count(const std::shared_ptr<utils::json_value> &json)
+	{
+		auto items = json->obj_get("items");
+		auto arr = items ? (*items)->arr() : std::nullopt;
+		if (!arr) return SIZE_MAX;
+		size_t cnt = 0;
+		for (const auto &item : *arr) {
+			(void)item; // Unused
+			++cnt;
+		}
+		return cnt;
+	}
+
+	inline bool lsp_workspace_diagnostic(const std::shared_ptr<utils::junit_test_suite> &suite)
+	{
+		bool ok = true;
+		auto &state = lsp::server_state::get();
+
+		for (const auto &wt : workspace_diagnostic_tests) {
+			utils::timer timer;
+
+			for (size_t ix=0; ix<wt.docs; ++ix) {
+				state.document_store.set("file:///workspace_diagnostic_test/" + std::to_string(ix) + ".hill", 1, "1 + 2");
+			}
+
+			auto params_ss = get_src(wt.partial ? "{\"previousResultIds\":[],\"partialResultToken\":\"t\"}" : "{\"previousResultIds\":[]}");
+			auto req = lsp::models::request_message{.id = 1, .method = lsp::models::method::WORKSPACE_DIAGNOSTIC, .params = utils::json_parser::parse(params_ss)};
+
+			std::stringstream ss;
+			auto res = lsp::methods::workspace_diagnostic(req, utils::cancellation_token());
+			if (auto result = std::get_if<std::optional<lsp::models::result_t>>(&res); result && *result) {
+				ss << json_items_count(**result);
+			}
+			for (const auto &msg : lsp::writer::take_queued()) {
+				std::stringstream msg_ss(msg);
+				auto json = utils::json_parser::parse(msg_ss);
+				auto params = json ? (*json)->obj_get("params") : std::nullopt;
+				auto value = params ? (*params)->obj_get("value") : std::nullopt;
+				ss << ',' << (value ? json_items_count(*value) : SIZE_MAX);
+			}
+
+			for (size_t ix=0; ix<wt.docs; ++ix) {
+				state.document_store.remove("file:///workspace_diagnostic_test/" + std::to_string(ix) + ".hill");
+			}
+
+			std::cout << " Test " << test(suite, timer.elapsed_sec(), wt.name, wt.expected, ss.str().c_str(), &ok);
+		}
+
+		return ok;
+	}
+
+	struct {
+		const char *name;
+		const char *text;
+		size_t begin, end;
+		const char *replacement;
+	} relex_tests[]={
+		{"Inside a name", "abc := 1;\nabc + 2", 1, 2, "x"},
+		{"Inside a number", "x := 1234 + 5", 7, 7, "'"},
+		{"Joining two tokens", "a + b", 1, 4, ""},
+		{"Splitting a token", "abcdef + 1", 3, 3, " "},
+		{"Across line breaks", "a := 1;\nb := 2;\nc := 3", 5, 10, "7;\n"},
+		{"Removing a line break", "a\nb\nc", 1, 2, ""},
+		{"Adding a line break", "a + b\nc", 3, 3, "\n"},
+		{"At the start", "a + b", 0, 0, "c := "},
+		{"At the end", "a + b", 5, 5, " * 2"},
+		{"Removing the end", "a + b;\nc", 5, 8, ""},
+		{"Into an empty document", "", 0, 0, "a + b"},
+		{"Removing everything", "a + b", 0, 5, ""},
+		{"Opening a comment", "a + b\nc + d", 2, 2, "/*"},
+		{"Closing a comment", "a /* b\nc + d", 6, 6, "*/"},
+		{"Opening a string", "a + \"b\" + c", 4, 4, "\""},
+		{"Past the end", "a + b", 3, 100, "c"},
+	};
+
+	inline std::string tokens_str(const std::vector<token> &tokens)
+	{
+		std::string s;
+		for (const auto &t : tokens) s += t.to_str() + ' ';
+		return s;
+	}
+
+	/**
+	 * Empty if the diff holds between the tokens, otherwise what does not
+	 */
+	inline std::string token_diff_error(const std::vector<token> &prev, const std::vector<token> &next, const lsp::token_diff &diff)
+	{
+		if (diff.prefix>next.size() || diff.prefix>diff.new_suffix || diff.new_suffix>next.size() || diff.old_suffix>prev.size()
+				|| next.size()-diff.new_suffix!=prev.size()-diff.old_suffix) {
+			return "bad ranges";
+		}
+		for (size_t ix=0; ix<diff.prefix; ++ix) {
+			if (prev[ix].to_str()!=next[ix].to_str()) return "prefix differs at " + std::to_string(ix);
+		}
+		for (size_t ix=0; ix<next.size()-diff.new_suffix; ++ix) {
+			auto t = prev[diff.old_suffix+ix].clone();
+			diff.move(t.lix, t.cix);
+			if (t.to_str()!=next[diff.new_suffix+ix].to_str()) return "suffix differs at " + std::to_string(diff.new_suffix+ix);
+		}
+		return "";
+	}
+
+	/**
+	 * Differences between the tokens of an edit and lexing the edited text from scratch
+	 */
+	inline std::string relex_error(const std::string &text, size_t begin, size_t end, const std::string &replacement)
+	{
+		auto prev = std::make_shared<const lsp::document>("file:///relex_test.hill", 1, text);
+		auto prev_tokens = prev->tokens();
+		auto next = prev->edit(begin, end, replacement, 2, nullptr);
+		auto full = lsp::document("file:///relex_test.hill", 2, next->text);
+
+		auto tokens = tokens_str(*next->tokens());
+		auto expected = tokens_str(*full.tokens());
+		if (tokens!=expected) return "tokens " + tokens + "instead of " + expected;
+		if (!next->get_token_diff()) {
+			// Expected only when the previous version could not be lexed to its end
+			const auto &last = prev_tokens->back();
+			return prev->position(text.size())==std::make_pair(last.lix, last.cix) ? "no token diff" : "";
+		}
+		auto error = token_diff_error(*prev_tokens, *next->tokens(), *next->get_token_diff());
+		return error.empty() ? "" : "token diff " + error;
+	}
+
+	inline bool lsp_relex(const std::shared_ptr<utils::junit_test_suite> &suite)
+	{
+		bool ok = true;
+
+		for (const auto &rt : relex_tests) {
+			utils::timer timer;
+			auto error = relex_error(rt.text, rt.begin, rt.end, rt.replacement);
+			std::cout << " Test " << test(suite, timer.elapsed_sec(), rt.name, "", error.c_str(), &ok);
+		}
+
+		// Edits of random places in random sizes, with snippets that change how the text around them lexes
+		const char *texts[] = {
+			"a := 1;\nb := a * 2.5;\n// c\n(a, b)",
+			"x := [1, 2, 3];\n/* y\n z */ x |> f\n\"s\" + 100'000u32",
+			"",
+		};
+		const char *snippets[] = {"", " ", "\n", "x", "1", ".5", "'", "/", "*", "//", "/*", "*/", "\"", ":=", "ab;\ncd", "\r\n"};
+
+		utils::timer timer;
+		std::mt19937 rng(1234);
+		std::string error;
+		for (int ix=0; ix<2000 && error.empty(); ++ix) {
+			std::string text = texts[rng()%(sizeof texts/sizeof texts[0])];
+			auto begin = rng()%(text.size()+1);
+			auto end = begin + rng()%(text.size()-begin+1)%8;
+			std::string replacement = snippets[rng()%(sizeof snippets/sizeof snippets[0])];
+
+			error = relex_error(text, begin, end, replacement);
+			if (!error.empty()) error = "edit " + std::to_string(begin) + ".." + std::to_string(end) + " of \"" + text + "\": " + error;
+		}
+		std::cout << " Test " << test(suite, timer.elapsed_sec(), "Random edits", "", error.c_str(), &ok);
+
+		return ok;
+	}
+
+	struct {
+		const char *name;
+		const char *text;
+		size_t begin, end;
+		const char *replacement;
+		const char *expected; // Statements analyzed again
+	} reanalysis_tests[]={
+		{"Changing a value", "a := 1;\nb := a;\nc := 2.5;\nb * c", 5, 6, "5", "reanalyzed 1"},
+		{"Changing the last statement", "a := 1;\nb := a;\nc := 2.5;\nb * c", 30, 31, "a", "reanalyzed 1"},
+		{"Changing a type", "a := 1;\nb := a;\nc := 2.5;\nb * c", 5, 6, "1.5", "reanalyzed 4"},
+		{"Adding a statement", "a := 1;\nb := a;\nc := 2.5;\nb * c", 26, 26, "d := 2;\n", "reanalyzed 2"},
+		{"Removing whitespace", "a := 1;\nb := a;\nc := 2.5;\nb * c", 9, 10, "", "reanalyzed 0"},
+		{"Adding an error", "a := 1;\nb := a;\nc := 2.5;\nb * c", 13, 14, "x", "reanalyzed 0"},
+		{"Removing an error", "a := 1;\nb := x;\nc := 2.5;\nb * c", 13, 14, "a", "reanalyzed 3"},
+	};
+
+	/**
+	 * Everything analysis leaves for the other requests, to tell a reused analysis from a new one
+	 */
+	inline std::string analysis_str(const lsp::document_analysis &analysis)
+	{
+		std::stringstream ss;
+		for (const auto &in : analysis.instrs()) {
+			ss << in.to_str() << ' ' << in.res_type.iref << ',' << in.arg1_type.iref << ',' << in.arg2_type.iref << '\n';
+		}
+		for (auto ix : analysis.token_instrs) ss << (ix==SIZE_MAX ? -1 : (long long)ix) << ' ';
+		ss << '\n';
+		for (const auto &[name, vals] : analysis.locals().ids) {
+			ss << name << ':';
+			for (const auto &val : vals) ss << ' ' << val.to_str();
+			ss << '\n';
+		}
+		ss << "frame " << analysis.locals().frame.ix << " error " << (analysis.error ? (int)*analysis.error : 0)
+			<< " at " << analysis.error_lix << ':' << analysis.error_cix;
+		return ss.str();
+	}
+
+	inline bool lsp_reanalysis(const std::shared_ptr<utils::junit_test_suite> &suite)
+	{
+		bool ok = true;
+
+		for (const auto &rt : reanalysis_tests) {
+			utils::timer timer;
+
+			auto prev = std::make_shared<const lsp::document>("file:///reanalysis_test.hill", 1, rt.text);
+			lsp::document_analysis::get(*prev);
+			auto next = prev->edit(rt.begin, rt.end, rt.replacement, 2, nullptr);
+			auto full = lsp::document("file:///reanalysis_test.hill", 2, next->text);
+
+			auto analysis = lsp::document_analysis::get(*next);
+			auto expected = analysis_str(*lsp::document_analysis::get(full));
+			auto actual = "reanalyzed " + std::to_string(analysis->reanalyzed);
+			if (analysis_str(*analysis)!=expected) actual += ", differs from a full analysis:\n" + analysis_str(*analysis) + "\ninstead of\n" + expected;
+
+			std::cout << " Test " << test(suite, timer.elapsed_sec(), rt.name, rt.expected, actual.c_str(), &ok);
+		}
+
+		return ok;
+	}
+
+	struct {
+		const char *src;
+		const char *expected; // Five numbers per token: line and start relative to the previous one, length, type, modifiers
+	} semantic_tokens_tests[]={
+		{"", ""},
+		{"a + 1", "0,0,1,3,0,0,2,1,4,0,0,2,1,2,0"},
+		{"a\r\nb", "0,0,1,3,0,1,0,1,3,0"},
+		{"/* a\nbc */ x", "0,0,4,0,0,1,0,5,0,0,0,6,1,3,0"},
+		{"/*\n\n*/", "0,0,2,0,0,2,0,2,0,0"},
+		{"x // c\ny", "0,0,1,3,0,0,2,4,0,0,1,0,1,3,0"},
+	};
+
+	struct {
+		const char *name;
+		const char *prev;
+		const char *next;
+	} semantic_tokens_diff_tests[]={
+		{"Unchanged", "a + 1", "a + 1"},
+		{"Edit at the start", "a + 1;\nb", "c := a + 1;\nb"},
+		{"Edit at the end", "a + 1;\nb", "a + 1;\nb * 2"},
+		{"Edit in the middle", "a + 1;\nb;\nc", "a + 1;\nbb + 2;\nc"},
+		{"Opening a comment over lines", "a + 1;\nb;\nc", "a /* + 1;\nb; */\nc"},
+		{"Closing a comment over lines", "a /* + 1;\nb; */\nc", "a + 1;\nb;\nc"},
+		{"From an empty document", "", "a + 1"},
+		{"To an empty document", "a + 1", ""},
+	};
+
+	inline std::string numbers_str(const std::vector<uint32_t> &numbers)
+	{
+		std::string s;
+		for (auto n : numbers) s += (s.empty() ? "" : ",") + std::to_string(n);
+		return s;
+	}
+
+	inline bool lsp_semantic_tokens(const std::shared_ptr<utils::junit_test_suite> &suite)
+	{
+		bool ok = true;
+
+		for (const auto &st : semantic_tokens_tests) {
+			utils::timer timer;
+			auto data = lsp::semantic_tokens::encode(lsp::document("file:///semantic_tokens_test.hill", 1, st.src));
+			std::cout << " Test " << test(suite, timer.elapsed_sec(), st.src, st.expected, numbers_str(data).c_str(), &ok);
+		}
+
+		for (const auto &dt : semantic_tokens_diff_tests) {
+			utils::timer timer;
+			auto prev = lsp::semantic_tokens::encode(lsp::document("file:///semantic_tokens_test.hill", 1, dt.prev));
+			auto next = lsp::semantic_tokens::encode(lsp::document("file:///semantic_tokens_test.hill", 2, dt.next));
+
+			// Edits are relative to the previous data, applied from the last one on
+			auto edits = lsp::semantic_tokens::diff(prev, next);
+			std::sort(edits.begin(), edits.end(), [](const auto &a, const auto &b) {return a.start>b.start;});
+			auto applied = prev;
+			for (const auto &edit : edits) {
+				if (edit.start+edit.delete_count>applied.size()) {
+					applied = {};
+					break;
+				}
+				auto at = applied.begin()+edit.start;
+				at = applied.erase(at, at+edit.delete_count);
+				applied.insert(at, edit.data.begin(), edit.data.end());
+			}
+
+			std::cout << " Test " << test(suite, timer.elapsed_sec(), dt.name, numbers_str(next).c_str(), numbers_str(applied).c_str(), &ok);
+		}
+
+		return ok;
+	}
+
+	inline bool lsp(utils::junit_session &test_session)
+	{
+		auto suite = test_session.add_suite("Test.LSP");
+
+		bool ok = true;
+
+		std::cout << "LSP testing:\n";
+
+		if (!lsp_workspace_diagnostic(suite)) ok = false;
+		if (!lsp_relex(suite)) ok = false;
+		if (!lsp_reanalysis(suite)) ok = false;
+		if (!lsp_semantic_tokens(suite)) ok = false;
+
+		return ok;
+	}
+}
+
+#endif /* HILL__TEST__LSP_HH_INCLUDED */
@@ -17,6 +17,8 @@ namespace hill::test {
 		{"1 + 2 * 3", "NUM(1),NUM(2),NUM(3),OP_STAR(*):Binary,OP_PLUS(+):Binary,END()"},
 		{"(1 + 2) * 3", "LPAR(),NUM(1),NUM(2),OP_PLUS(+):Binary,RPAR()),NUM(3),OP_STAR(*):Binary,END()"},
 		{"1 2", "NUM(1),NUM(2),CALL():Binary,END()"},
+		{"2 - -128i8", "NUM(2),NUM(-128i8),OP_MINUS(-):Binary,END()"},
+		{"-128 * - 1i8", "NUM(128),OP_MINUS(-):Left unary,NUM(1i8),OP_MINUS(-):Left unary,OP_STAR(*):Binary,END()"},
 	};
 
 	inline bool parser(utils::junit_session &test_session)
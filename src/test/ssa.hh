@@ -0,0 +1,73 @@
+#ifndef HILL__TEST__SSA_HH_INCLUDED
+#define HILL__TEST__SSA_HH_INCLUDED
+
+#include "../lexer.hh"
+#include "../parser.hh"
+#include "../analyzer.hh"
+#include "../hill.hh"
+#include "../ssa.hh"
+#include "../opt/ssa_passes.hh"
+#include "../utils/console.hh"
+
+#include "./support.hh"
+
+#include <sstream>
+#include <string>
+
+namespace hill::test {
+
+	struct {
+		const char *src;
+		const char *expected; // Instruction counts before and after optimization
+	} ssa_tests[]={
+		{"1 + 2", "3/3"},
+		{"(a := 1, a + a)", "4/3"},
+		{"pow (2, 3) + pow (2, 3)", "11/6"},
+		{"(abs (-1), abs (-1))", "9/5"},
+		{"abs (-1) + abs 1", "8/6"},
+		{"div (4, 2) + div (4, 2)", "11/7"},
+	};
+
+	inline bool ssa(utils::junit_session &test_session)
+	{
+		auto suite = test_session.add_suite("Test.SSA");
+
+		bool ok = true;
+
+		std::cout << "SSA testing:\n";
+
+		for (size_t ix=0; ix<sizeof ssa_tests/sizeof ssa_tests[0]; ++ix) {
+			utils::timer timer;
+			auto src_ss = get_src(ssa_tests[ix].src);
+
+			std::stringstream ss;
+			try {
+				::hill::lexer l;
+				::hill::parser p;
+				::hill::analyzer a;
+				p.parse(src_ss, l);
+				a.set_trunk(build_lib(build_root()));
+				a.analyze(p.get_rpn());
+				a.optimize();
+
+				auto f = ::hill::ssa::lower(a.get_main_block());
+				ss << f.instr_count() << '/';
+				opt::optimize(f);
+				ss << f.instr_count();
+			} catch (::hill::exception &ex) {
+				ss << error_code_to_str(ex.get_error_code());
+			}
+
+			std::cout << " Test " << test(
+				suite, timer.elapsed_sec(),
+				ssa_tests[ix].src,
+				ssa_tests[ix].expected,
+				ss.str().c_str(),
+				&ok);
+		}
+
+		return ok;
+	}
+}
+
+#endif /* HILL__TEST__SSA_HH_INCLUDED */
@@ -1,9 +1,23 @@
 #ifndef HILL__TYPE_HH_INCLUDED
 #define HILL__TYPE_HH_INCLUDED
 
+#include "exceptions.hh"
+#include "utils/string.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
-#include <numeric>
 
 namespace hill {
 
@@ -22,6 +36,25 @@ namespace hill {
 		END,
 	};
 
+#ifdef HILL_PACKED_LAYOUT
+	constexpr bool packed_layout = true; // Elements one after the other, no padding
+#else
+	constexpr bool packed_layout = false; // Elements at offsets aligned to their size, like C structs
+#endif
+
+	constexpr size_t align_up(size_t ix, size_t align)
+	{
+		return (ix + align - 1) / align * align;
+	}
+
+	/**
+	 * Alignment used in layouts for a value that is naturally aligned to align
+	 */
+	constexpr size_t layout_align(size_t align)
+	{
+		return packed_layout ? 1u : align;
+	}
+
 	constexpr size_t basic_type_size(basic_type bt)
 	{
 		switch (bt) {
@@ -84,32 +117,33 @@ namespace hill {
 		return t==basic_type::FUNC || t==basic_type::TUPLE || t==basic_type::ARRAY;
 	}
 
-	inline std::vector<basic_type> inner_type(std::vector<basic_type> types, size_t ix)
+	/**
+	 * Number of basic types making up the type starting at ix, zero at the END of a composite type
+	 */
+	inline size_t inner_type_len(std::span<const basic_type> types, size_t ix)
 	{
 		if (ix>=types.size()) throw internal_exception();
-			
-		std::vector<basic_type> inner_types;
-
-		if (types[ix]==basic_type::END) {
-			return inner_types;
-		} else if (is_composite_type(types[ix])) {
-			inner_types.push_back(types[ix]);
-			int lvl = 1;
-			while (lvl>0) {
-				if (++ix>=types.size()) throw internal_exception();
-				inner_types.push_back(types[ix]);
-
-				if (is_composite_type(types[ix])) ++lvl;
-				else if (types[ix]==basic_type::END) --lvl;
-			}
-		} else {
-			inner_types.push_back(types[ix]);
+
+		if (types[ix]==basic_type::END) return 0;
+		if (!is_composite_type(types[ix])) return 1;
+
+		size_t end = ix;
+		int lvl = 1;
+		while (lvl>0) {
+			if (++end>=types.size()) throw internal_exception();
+
+			if (is_composite_type(types[end])) ++lvl;
+			else if (types[end]==basic_type::END) --lvl;
 		}
+		return end - ix + 1;
+	}
 
-		return inner_types;
+	inline std::span<const basic_type> inner_type(std::span<const basic_type> types, size_t ix)
+	{
+		return types.subspan(ix, inner_type_len(types, ix));
 	}
 
-	inline std::string type_to_str(std::vector<basic_type> types)
+	inline std::string type_to_str(std::span<const basic_type> types)
 	{
 		if (types.empty()) return "";
 
@@ -119,7 +153,7 @@ namespace hill {
 		case basic_type::FUNC:
 			{
 				ss << "@fn(";
-				std::vector<basic_type> itypes = inner_type(types, 1);
+				auto itypes = inner_type(types, 1);
 				ss << type_to_str(itypes);
 				ss << ",";
 				ss << type_to_str(inner_type(types, itypes.size() + 1));
@@ -129,7 +163,7 @@ namespace hill {
 		case basic_type::TUPLE:
 			{
 				ss << "(";
-				std::vector<basic_type> itypes;
+				std::span<const basic_type> itypes;
 				size_t ix;
 				for (ix = 1; ix<types.size()-1; ix+=itypes.size()) {
 					itypes = inner_type(types, ix);
@@ -142,7 +176,8 @@ namespace hill {
 		case basic_type::ARRAY:
 			{
 				ss << "@array(";
-				std::vector<basic_type> itypes = inner_type(types, 1);
+				auto itypes = inner_type(types, 1);
+				if (itypes.size()+1>=types.size()) throw internal_exception();
 				ss << type_to_str(itypes);
 				ss << ",";
 				ss << (size_t)types[itypes.size()+1];
@@ -162,42 +197,6 @@ namespace hill {
 		return ss.str();
 	}
 
-	inline size_t type_size(std::vector<basic_type> types)
-	{
-		if (types.empty()) return 0;
-
-		std::ostringstream ss;
-
-		switch (types[0]) {
-		case basic_type::FUNC:
-			return sizeof(void*);
-		case basic_type::TUPLE:
-			{
-				size_t tsize = 0;
-				std::vector<basic_type> itypes;
-				size_t ix;
-				for (ix = 1; ix<types.size()-1; ix+=itypes.size()) {
-					itypes = inner_type(types, ix);
-					tsize += type_size(itypes);
-				}
-				return tsize;
-			}
-		case basic_type::ARRAY:
-			{
-				std::vector<basic_type> itypes = inner_type(types, 1);
-				return type_size(itypes) * (size_t)types[itypes.size()+1];
-			}
-		case basic_type::BLOCK:
-			return 0;
-		case basic_type::BIEXPR:
-			return 0;
-		case basic_type::ANON:
-			return 0;
-		default:
-			return basic_type_size(types[0]);
-		}
-	}
-
 	enum class type_kind {
 		PLACEHOLDER,
 		DEPENDENT,
@@ -214,31 +213,293 @@ namespace hill {
 		std::vector<type_dict_entry> entries;
 	};
 
-	struct type {
-		type() = default;
-		explicit type(basic_type bt): types{bt} {}
-		explicit type(const std::vector<basic_type> &bts): types(bts) {}
-		//type_spec(const type_spec &other): types(other.types) {}
-		bool operator==(const type &other) const {return this->types == other.types;}
-		bool operator!=(const type &other) const {return !(*this==other);}
-		bool operator<(const type &other) const {return this->types < other.types;}
-		bool matches(const type &other) const {
-			for (size_t ix=0; ix<this->types.size(); ++ix) {
-				// TODO: First condition is a hack to avoid mismatching missing END in incomplete tuple
-				if (this->types[ix]!=basic_type::END && this->types[ix]!=other.types[ix] && this->types[ix]!=basic_type::UNDECIDED) {
-					return false;
+	typedef uint32_t type_id;
+
+	/**
+	 * What is known about one distinct type, worked out once when it is interned.
+	 * The layout is flat, nested elements are found by following element ids, never by walking the basic types.
+	 */
+	struct type_desc {
+		struct elm {
+			type_id id;
+			size_t ix; // Of the first basic type of the element
+			size_t mem_offset;
+		};
+
+		std::vector<basic_type> types;
+		std::optional<std::string> str = {}; // Empty if the type cannot be printed
+		std::optional<size_t> mem_size = {}; // Empty if the type has no size, includes padding
+		size_t mem_align = 1;
+
+		type_id func_ret = 0, func_arg = 0; // FUNC
+		std::vector<elm> elms = {}; // TUPLE, in order
+		type_id array_elm = 0; // ARRAY
+		size_t array_cnt = 0;
+	};
+
+	/**
+	 * Every distinct type stored once and shared by all threads.
+	 * Types are never removed, so an id and its description stay valid for the rest of the program.
+	 * Interning a composite type takes a lock, looking up a description never does.
+	 */
+	struct type_table {
+		static type_table &get()
+		{
+			static type_table table;
+			return table;
+		}
+
+		/**
+		 * Id of a type made of one basic type, the same in every run
+		 */
+		static constexpr type_id basic_id(basic_type bt) {return (type_id)bt + 1u;}
+
+		type_id intern(std::span<const basic_type> types)
+		{
+			if (types.size()==1) return basic_id(types[0]);
+
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				auto it = ids.find(types);
+				if (it!=ids.end()) return it->second;
+			}
+
+			// Interns the inner types, so it runs without holding the lock
+			auto desc = make_desc(types);
+
+			std::lock_guard<std::mutex> guard(mutex);
+			auto [it, added] = ids.try_emplace(std::vector<basic_type>(types.begin(), types.end()), (type_id)cnt);
+			if (added) add(std::move(desc));
+			return it->second;
+		}
+
+		const type_desc &at(type_id id) const
+		{
+			return chunks[id>>CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE-1)];
+		}
+
+		size_t size() const {return cnt.load();}
+
+		/**
+		 * Memory held by the table. It only grows, every distinct tuple shape or array length
+		 * ever typed stays, so a long-running process should watch this.
+		 */
+		size_t approx_bytes()
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			auto n = cnt.load();
+			size_t bytes = ((n + CHUNK_SIZE - 1)>>CHUNK_BITS)*CHUNK_SIZE*sizeof(type_desc);
+			for (size_t id=0; id<n; ++id) {
+				const auto &desc = at((type_id)id);
+				bytes += desc.types.capacity()*sizeof(basic_type) + desc.elms.capacity()*sizeof(type_desc::elm);
+				if (desc.str) bytes += desc.str->capacity();
+			}
+			for (const auto &[types, id] : ids) bytes += types.capacity()*sizeof(basic_type) + sizeof types + sizeof id + 2*sizeof(void *);
+			return bytes;
+		}
+
+		~type_table()
+		{
+			for (auto &chunk : chunks) delete[] chunk.load();
+		}
+
+	private:
+		static constexpr size_t CHUNK_BITS = 12;
+		static constexpr size_t CHUNK_SIZE = (size_t)1<<CHUNK_BITS;
+		static constexpr size_t MAX_CHUNKS = (size_t)1<<14;
+
+		// Looked up by span, so finding an interned type does not copy it
+		struct types_hash {
+			using is_transparent = void;
+			size_t operator()(std::span<const basic_type> types) const
+			{
+				return (size_t)utils::fnv1a_64(std::string_view((const char *)types.data(), types.size()*sizeof(basic_type)));
+			}
+		};
+
+		struct types_equal {
+			using is_transparent = void;
+			bool operator()(std::span<const basic_type> a, std::span<const basic_type> b) const
+			{
+				return std::equal(a.begin(), a.end(), b.begin(), b.end());
+			}
+		};
+
+		std::mutex mutex;
+		std::unordered_map<std::vector<basic_type>, type_id, types_hash, types_equal> ids;
+		std::array<std::atomic<type_desc *>, MAX_CHUNKS> chunks = {};
+		std::atomic<size_t> cnt = 0;
+
+		type_table()
+		{
+			// The empty type first, then every basic type at its basic_id
+			add(make_desc({}));
+			for (auto bt=basic_type::UNDECIDED; bt<=basic_type::END; bt=(basic_type)((int)bt + 1)) {
+				ids.try_emplace(std::vector<basic_type>{bt}, (type_id)cnt);
+				add(make_desc(std::vector<basic_type>{bt}));
+			}
+		}
+
+		void add(type_desc &&desc)
+		{
+			auto id = cnt.load();
+			if ((id>>CHUNK_BITS)>=MAX_CHUNKS) throw internal_exception();
+
+			auto &chunk = chunks[id>>CHUNK_BITS];
+			if (!chunk.load()) chunk.store(new type_desc[CHUNK_SIZE], std::memory_order_release);
+			chunk.load()[id & (CHUNK_SIZE-1)] = std::move(desc);
+			cnt.store(id + 1);
+		}
+
+		type_desc make_desc(std::span<const basic_type> types)
+		{
+			type_desc desc{.types = std::vector<basic_type>(types.begin(), types.end())};
+
+			// Types the analyzer makes up along the way may have no size or string form
+			try {
+				desc.str = type_to_str(types);
+			} catch (const internal_exception &) {}
+
+			if (types.empty()) {
+				desc.mem_size = 0;
+				return desc;
+			}
+
+			try {
+				switch (types[0]) {
+				case basic_type::FUNC:
+					{
+						desc.mem_size = sizeof(void *);
+						desc.mem_align = layout_align(alignof(void *));
+						auto ret = inner_type(types, 1);
+						desc.func_ret = intern(ret);
+						desc.func_arg = intern(inner_type(types, 1 + ret.size()));
+					}
+					break;
+				case basic_type::TUPLE:
+					{
+						// Each element at the next offset aligned for it, the size rounded up so tuples can follow each other
+						size_t end = 0;
+						bool sized = true;
+						std::span<const basic_type> itypes;
+						for (size_t ix=1; ix<types.size()-1; ix+=itypes.size()) {
+							itypes = inner_type(types, ix);
+							auto id = intern(itypes);
+							const auto &elm = at(id);
+							auto mem_offset = align_up(end, elm.mem_align);
+							desc.elms.push_back(type_desc::elm{.id = id, .ix = ix, .mem_offset = mem_offset});
+							desc.mem_align = std::max(desc.mem_align, elm.mem_align);
+							end = mem_offset + elm.mem_size.value_or(0);
+							sized = sized && elm.mem_size;
+						}
+						if (sized) desc.mem_size = align_up(end, desc.mem_align);
+					}
+					break;
+				case basic_type::ARRAY:
+					{
+						auto itypes = inner_type(types, 1);
+						if (itypes.size()+1>=types.size()) throw internal_exception();
+						desc.array_elm = intern(itypes);
+						desc.array_cnt = (size_t)types[itypes.size()+1];
+
+						// Element sizes are already a multiple of their alignment
+						const auto &elm = at(desc.array_elm);
+						desc.mem_align = elm.mem_align;
+						if (elm.mem_size) desc.mem_size = *elm.mem_size * desc.array_cnt;
+					}
+					break;
+				case basic_type::BLOCK:
+				case basic_type::BIEXPR:
+				case basic_type::ANON:
+					desc.mem_size = 0;
+					break;
+				default:
+					desc.mem_size = basic_type_size(types[0]);
+					desc.mem_align = layout_align(*desc.mem_size);
 				}
+			} catch (const internal_exception &) {
+				desc.elms.clear();
 			}
-			return true;
+
+			return desc;
 		}
-		
-		std::vector<basic_type> types;
-		std::map<std::string, size_t> names_inner_type;
-		std::map<std::string, size_t> names_mem_offset;
-		size_t num_elms = 0u;
+	};
+
+	/**
+	 * Basic types of a type being put together, kept inline while short.
+	 * Building a type that is already interned then looks it up without allocating.
+	 */
+	struct type_buffer {
+		static constexpr size_t INLINE_CNT = 16;
+
+		void push_back(basic_type bt)
+		{
+			append(std::span<const basic_type>(&bt, 1));
+		}
+
+		void append(std::span<const basic_type> bts)
+		{
+			if (heap.empty() && cnt + bts.size()<=INLINE_CNT) {
+				std::copy(bts.begin(), bts.end(), inline_types.begin() + cnt);
+			} else {
+				if (heap.empty()) heap.assign(inline_types.begin(), inline_types.begin() + cnt);
+				heap.insert(heap.end(), bts.begin(), bts.end());
+			}
+			cnt += bts.size();
+		}
+
+		std::span<const basic_type> span() const
+		{
+			return heap.empty() ? std::span<const basic_type>(inline_types.data(), cnt) : std::span<const basic_type>(heap);
+		}
+
+	private:
+		std::array<basic_type, INLINE_CNT> inline_types;
+		size_t cnt = 0;
+		std::vector<basic_type> heap; // All of the types once they do not fit inline
+	};
+
+	/**
+	 * A type as used during analysis, the interned id and where the value came from
+	 */
+	struct type {
+		type() = default;
+		explicit type(basic_type bt): id(type_table::basic_id(bt)) {}
+		explicit type(const std::vector<basic_type> &bts): id(type_table::get().intern(bts)) {}
+		explicit type(std::span<const basic_type> bts): id(type_table::get().intern(bts)) {}
+
+		static type from_id(type_id id)
+		{
+			type t;
+			t.id = id;
+			return t;
+		}
+
+		bool operator==(const type &other) const {return this->id == other.id;}
+		bool operator!=(const type &other) const {return !(*this==other);}
+		bool operator<(const type &other) const {return this->id < other.id;}
+
+		// Flags next to the id, so a type copied around the type stack and instructions stays two words
+		type_id id = 0; // The empty type, a name not resolved yet
 		bool tuple_closed = false;
-		size_t iref = SIZE_MAX;
 		bool is_pipe_arg = false;
+		bool is_pure_func = false; // A function whose result depends on its argument only, without side effects
+		size_t iref = SIZE_MAX;
+
+		const type_desc &desc() const
+		{
+			return type_table::get().at(id);
+		}
+
+		const std::vector<basic_type> &types() const
+		{
+			return desc().types;
+		}
+
+		size_t num_elms() const
+		{
+			return desc().elms.size();
+		}
 
 		void close_tuple()
 		{
@@ -247,63 +508,77 @@ namespace hill {
 
 		basic_type first() const
 		{
+			const auto &types = this->types();
 			return types.empty() ? basic_type::UNDECIDED : types[0];
 		}
 
 		type inner_type(size_t ix) const
 		{
-			return type(::hill::inner_type(types, ix));
+			return type(::hill::inner_type(types(), ix));
 		}
 
 		std::string to_str() const
 		{
-			return ::hill::type_to_str(types);
+			const auto &str = desc().str;
+			if (!str) throw internal_exception();
+			return *str;
 		}
 
 		size_t mem_size() const
 		{
-			return ::hill::type_size(types);
+			const auto &mem_size = desc().mem_size;
+			if (!mem_size) throw internal_exception();
+			return *mem_size;
+		}
+
+		size_t mem_align() const
+		{
+			return desc().mem_align;
 		}
 	};
 
 	inline type build_tuple(const type &left, const type &right)
 	{
-		std::vector<basic_type> types;
-		size_t num_elms;
+		const auto &ltypes = left.types();
+		const auto &rtypes = right.types();
+		type_buffer types;
 
 		types.push_back(basic_type::TUPLE);
 
 		if (left.first()==basic_type::TUPLE && !left.tuple_closed) {
-			types.insert(types.end(), left.types.cbegin()+1, left.types.cend()-1);
-			num_elms = left.num_elms + 1;
+			types.append(std::span<const basic_type>(ltypes).subspan(1, ltypes.size()-2));
 		} else {
-			types.insert(types.end(), left.types.cbegin(), left.types.cend());
-			num_elms = 2;
+			types.append(ltypes);
 		}
 
-		types.insert(types.end(), right.types.cbegin(), right.types.cend());
+		types.append(rtypes);
 
 		types.push_back(basic_type::END);
 
-		auto t = type(types);
-		std::string elm_name = "_" + std::to_string(num_elms-1);
-		t.names_inner_type[elm_name] = left.types.size()-2u+1u;
-		t.names_mem_offset[elm_name] = left.mem_size();
-		t.num_elms = num_elms;
+		return type(types.span());
+	}
 
-		return t;
+	/**
+	 * Element of a tuple by its name, _0 for the first one
+	 */
+	inline const type_desc::elm &get_tuple_elm(const type &tuple_type, const std::string &id)
+	{
+		const auto &elms = tuple_type.desc().elms;
+		size_t ix = 0;
+		if (id.size()<2 || id[0]!='_') throw semantic_error_exception(error_code::UNKNOWN_MEMBER_NAME);
+		auto [end, ec] = std::from_chars(id.data() + 1, id.data() + id.size(), ix);
+		if (ec!=std::errc() || end!=id.data() + id.size() || ix>=elms.size()) throw semantic_error_exception(error_code::UNKNOWN_MEMBER_NAME);
+		return elms[ix];
 	}
 
 	inline type get_tuple_elm_type(const type &tuple_type, const std::string &id)
 	{
-		if (!tuple_type.names_inner_type.contains(id)) throw semantic_error_exception(error_code::UNKNOWN_MEMBER_NAME);
-		return tuple_type.inner_type(tuple_type.names_inner_type.at(id));
+		return type::from_id(get_tuple_elm(tuple_type, id).id);
 	}
 
 	inline size_t get_tuple_elm_mem_offset(const type &tuple_type, const std::string &id)
 	{
-		if (!tuple_type.names_mem_offset.contains(id)) throw semantic_error_exception(error_code::UNKNOWN_MEMBER_NAME);
-		return tuple_type.names_mem_offset.at(id);
+		return get_tuple_elm(tuple_type, id).mem_offset;
 	}
 }
 
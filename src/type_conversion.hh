@@ -3,39 +3,83 @@
 
 #include "type.hh"
 
-#include <map>
+#include <array>
+#include <stddef.h>
 
 namespace hill {
 
-	inline const std::map<const type, std::map<const type, const type>> &get_conversions()
+	constexpr size_t NUM_BASIC_TYPES = (size_t)basic_type::END + 1;
+
+	constexpr bool is_signed_int_type(basic_type bt)
 	{
-		static std::map<const type, std::map<const type, const type>> conversions = {
-			{type(basic_type::UNDECIDED),
-				{
-					{type(basic_type::I), type(basic_type::I32)},
-					{type(basic_type::I32), type(basic_type::I32)}
-				},
-			}
-		};
+		return bt>=basic_type::I && bt<=basic_type::I64;
+	}
 
-		return conversions;
+	constexpr bool is_unsigned_int_type(basic_type bt)
+	{
+		return bt>=basic_type::U && bt<=basic_type::U64;
 	}
 
-	inline const type convert(const type &target, const type &src)
+	constexpr bool is_float_type(basic_type bt)
 	{
-		if (target==type(basic_type::UNDECIDED)) {
-			if (src==type(basic_type::I) || src==type(basic_type::I32)) return type(basic_type::I32);
-			else return target;
-		} else return target;
+		return bt>=basic_type::F && bt<=basic_type::F64;
 	}
 
-	inline const type convert_binary(tt op, const type &left, const type &right)
+	constexpr bool is_num_type(basic_type bt)
 	{
-		switch (op) {
-		case tt::OP_COLON_EQ:
-			return convert(left, right);
-		default: throw not_implemented_exception();
+		return is_signed_int_type(bt) || is_unsigned_int_type(bt) || is_float_type(bt);
+	}
+
+	/**
+	 * Type both operands of an arithmetic operation are converted to, UNDECIDED if they are not both numbers.
+	 * A float wins over an integer and the wider of two types wins. Mixing signed and unsigned integers gives
+	 * the signed type if it is wider and the unsigned type otherwise, like C without the promotion to int.
+	 */
+	constexpr basic_type common_num_type(basic_type a, basic_type b)
+	{
+		if (!is_num_type(a) || !is_num_type(b)) return basic_type::UNDECIDED;
+		if (a==b) return a;
+
+		// Of the same size, a sized type wins over @i, @u and @f
+		auto wider = [](basic_type x, basic_type y) {
+			if (basic_type_size(x)!=basic_type_size(y)) return basic_type_size(x)>basic_type_size(y) ? x : y;
+			return x==basic_type::I || x==basic_type::U || x==basic_type::F ? y : x;
+		};
+
+		if (is_float_type(a) && is_float_type(b)) return wider(a, b);
+		if (is_float_type(a)) return a;
+		if (is_float_type(b)) return b;
+
+		if (is_signed_int_type(a)==is_signed_int_type(b)) return wider(a, b);
+		auto s = is_signed_int_type(a) ? a : b;
+		auto u = is_signed_int_type(a) ? b : a;
+		return basic_type_size(s)>basic_type_size(u) ? s : u;
+	}
+
+	/**
+	 * common_num_type of every pair of basic types, worked out at compile time
+	 */
+	constexpr auto num_conversions = [] {
+		std::array<std::array<basic_type, NUM_BASIC_TYPES>, NUM_BASIC_TYPES> conversions{};
+		for (size_t a=0; a<NUM_BASIC_TYPES; ++a) {
+			for (size_t b=0; b<NUM_BASIC_TYPES; ++b) conversions[a][b] = common_num_type((basic_type)a, (basic_type)b);
 		}
+		return conversions;
+	}();
+
+	static_assert(num_conversions[(size_t)basic_type::I32][(size_t)basic_type::F64]==basic_type::F64);
+	static_assert(num_conversions[(size_t)basic_type::U8][(size_t)basic_type::I32]==basic_type::I32);
+	static_assert(num_conversions[(size_t)basic_type::U32][(size_t)basic_type::I32]==basic_type::U32);
+
+	/**
+	 * Type an arithmetic operation on two numbers gives, the empty type if either is not a number
+	 */
+	inline type arith_type(const type &left, const type &right)
+	{
+		if (left.types().size()!=1 || right.types().size()!=1) return type();
+
+		auto bt = num_conversions[(size_t)left.first()][(size_t)right.first()];
+		return bt==basic_type::UNDECIDED ? type() : type(bt);
 	}
 }
 
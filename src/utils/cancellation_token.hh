@@ -0,0 +1,45 @@
+#ifndef HILL__UTILS__CANCELLATION_TOKEN_HH_INCLUDED
+#define HILL__UTILS__CANCELLATION_TOKEN_HH_INCLUDED
+
+#include "../exceptions.hh"
+
+#include <atomic>
+#include <memory>
+
+namespace hill::utils {
+
+	/// <summary>
+	/// Shared flag used to cooperatively abort long running work.
+	/// A default constructed token can never be cancelled.
+	/// </summary>
+	struct cancellation_token {
+		cancellation_token() = default;
+
+		static cancellation_token create()
+		{
+			cancellation_token token;
+			token.state = std::make_shared<std::atomic<bool>>(false);
+			return token;
+		}
+
+		void cancel() const
+		{
+			if (state) state->store(true, std::memory_order_relaxed);
+		}
+
+		bool cancelled() const
+		{
+			return state && state->load(std::memory_order_relaxed);
+		}
+
+		void throw_if_cancelled() const
+		{
+			if (cancelled()) throw cancelled_exception();
+		}
+
+	private:
+		std::shared_ptr<std::atomic<bool>> state;
+	};
+}
+
+#endif /* HILL__UTILS__CANCELLATION_TOKEN_HH_INCLUDED */
@@ -0,0 +1,89 @@
+#ifndef HILL__UTILS__HISTOGRAM_HH_INCLUDED
+#define HILL__UTILS__HISTOGRAM_HH_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace hill::utils {
+
+	/// <summary>
+	/// Lock-free log-linear histogram in the style of HdrHistogram.
+	/// Every power of two is split in 16 linear buckets, so any reported value
+	/// is at most ~6% above the recorded one. Values above MAX_VALUE are clamped.
+	/// </summary>
+	struct histogram {
+		enum {
+			SUB_BITS = 4,
+			SUB_CNT = 1<<SUB_BITS,
+			VALUE_BITS = 36,
+			BUCKET_CNT = (VALUE_BITS-SUB_BITS+1)*SUB_CNT,
+		};
+		static constexpr uint64_t MAX_VALUE = (uint64_t(1)<<VALUE_BITS)-1;
+
+		void record(uint64_t value)
+		{
+			value = std::min(value, MAX_VALUE);
+			buckets[bucket_ix(value)].fetch_add(1, std::memory_order_relaxed);
+			cnt.fetch_add(1, std::memory_order_relaxed);
+			sum.fetch_add(value, std::memory_order_relaxed);
+
+			auto prev = max_value.load(std::memory_order_relaxed);
+			while (prev<value && !max_value.compare_exchange_weak(prev, value, std::memory_order_relaxed));
+		}
+
+		uint64_t count() const {return cnt.load(std::memory_order_relaxed);}
+		uint64_t max() const {return max_value.load(std::memory_order_relaxed);}
+
+		double mean() const
+		{
+			auto n = count();
+			return n ? (double)sum.load(std::memory_order_relaxed) / (double)n : 0.0;
+		}
+
+		/// <summary>
+		/// Upper bound of the bucket holding the given percentile (0-100)
+		/// </summary>
+		uint64_t percentile(double p) const
+		{
+			auto n = count();
+			if (!n) return 0;
+
+			auto target = std::max(uint64_t(1), (uint64_t)std::ceil(p / 100.0 * (double)n));
+			uint64_t seen = 0;
+			for (size_t ix=0; ix<BUCKET_CNT; ++ix) {
+				seen += buckets[ix].load(std::memory_order_relaxed);
+				if (seen>=target) return std::min(bucket_max(ix), max());
+			}
+			return max();
+		}
+
+	private:
+		static size_t bucket_ix(uint64_t value)
+		{
+			if (value<SUB_CNT) return (size_t)value;
+			auto shift = (size_t)std::bit_width(value) - SUB_BITS - 1;
+			auto sub = (size_t)(value>>shift); // In [SUB_CNT, 2*SUB_CNT)
+			return (shift+1)*SUB_CNT + (sub-SUB_CNT);
+		}
+
+		static uint64_t bucket_max(size_t ix)
+		{
+			if (ix<SUB_CNT) return ix;
+			auto shift = ix/SUB_CNT - 1;
+			auto sub = (uint64_t)(ix%SUB_CNT + SUB_CNT);
+			return ((sub+1)<<shift) - 1;
+		}
+
+	private:
+		std::array<std::atomic<uint64_t>, BUCKET_CNT> buckets = {};
+		std::atomic<uint64_t> cnt = 0;
+		std::atomic<uint64_t> sum = 0;
+		std::atomic<uint64_t> max_value = 0;
+	};
+}
+
+#endif /* HILL__UTILS__HISTOGRAM_HH_INCLUDED */
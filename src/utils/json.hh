@@ -1,6 +1,9 @@
 #ifndef HILL__UTILS__JSON_HH_INCLUDED
 #define HILL__UTILS__JSON_HH_INCLUDED
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <exception>
 #include <memory>
 #include <optional>
@@ -341,8 +344,16 @@ namespace hill::utils {
 				ss << '"' << json_escape_str(std::get<std::string>(value).c_str()) << '"';
 				break;
 			case json_value_kind::NUMBER:
-				ss << std::get<number_t>(value);
+			{
+				// Integers are printed exactly, the default stream precision would round them
+				auto number = std::get<number_t>(value);
+				if (number==std::trunc(number) && std::abs(number)<9007199254740992.0) {
+					ss << (int64_t)number;
+				} else {
+					ss << number;
+				}
 				break;
+			}
 			case json_value_kind::BOOL:
 				ss << (std::get<bool>(value) ? "true" : "false");
 				break;
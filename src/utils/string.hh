@@ -3,10 +3,12 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <ios>
 #include <locale>
 #include <string>
 #include <sstream>
+#include <string_view>
 
 namespace hill::utils {
 
@@ -64,6 +66,19 @@ namespace hill::utils {
 		ltrim(s);
 		rtrim(s);
 	}
+
+	/// <summary>
+	/// 64-bit FNV-1a hash of the bytes, stable between runs and platforms.
+	/// Pass the previous hash to continue hashing after earlier bytes.
+	/// </summary>
+	inline uint64_t fnv1a_64(std::string_view s, uint64_t hash=0xcbf29ce484222325ull)
+	{
+		for (unsigned char ch : s) {
+			hash ^= ch;
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
 }
 
 #endif /* HILL__UTILS__STRING_HH_INCLUDED */
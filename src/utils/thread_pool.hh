@@ -1,6 +1,10 @@
 #ifndef HILL__UTILS__THREAD_POOL_HH_INCLUDED
 #define HILL__UTILS__THREAD_POOL_HH_INCLUDED
 
+#include "histogram.hh"
+
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <vector>
 #include <thread>
@@ -64,34 +68,70 @@ namespace hill::utils {
 		{
 			{
 				std::unique_lock<std::mutex> lock(queue_mutex);
-				jobs.push(job);
+				jobs.push(queued_job{.run = job, .queued = std::chrono::steady_clock::now()});
+
+				auto depth = jobs.size();
+				if (depth>max_queue_depth.load(std::memory_order_relaxed)) {
+					max_queue_depth.store(depth, std::memory_order_relaxed);
+				}
 			}
 			mutex_condition.notify_one();
 		}
 
+		size_t thread_count() const
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			return threads.size();
+		}
+
+		size_t queue_depth() const
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			return jobs.size();
+		}
+
+		size_t get_max_queue_depth() const {return max_queue_depth.load(std::memory_order_relaxed);}
+
+		/**
+		 * Time in microseconds from queue_job until a thread picked up the job
+		 */
+		const histogram &get_queue_wait() const {return queue_wait;}
+
 	private:
+		struct queued_job {
+			std::function<void()> run;
+			std::chrono::steady_clock::time_point queued;
+		};
+
 		std::vector<std::thread> threads;
 		bool should_terminate;
-		std::queue<std::function<void()>> jobs;
-		std::mutex queue_mutex;
+		std::queue<queued_job> jobs;
+		mutable std::mutex queue_mutex;
 		std::condition_variable mutex_condition; // Allows threads to wait on new jobs or termination
 
+		std::atomic<size_t> max_queue_depth = 0;
+		histogram queue_wait;
+
 	private:
 		void thread_loop()
 		{
 			while (true) {
-				std::function<void()> job;
+				queued_job job;
 				{
 					std::unique_lock<std::mutex> lock(queue_mutex);
 					mutex_condition.wait(lock, [this] {return !jobs.empty() || should_terminate;});
 					if (should_terminate) {
 						return;
 					}
-					job = jobs.front();
+					job = std::move(jobs.front());
 					jobs.pop();
 				}
+
+				auto waited = std::chrono::steady_clock::now() - job.queued;
+				queue_wait.record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(waited).count());
+
 				try {
-					job();
+					job.run();
 				} catch (const std::exception &) {}
 			}
 		}
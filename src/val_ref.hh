@@ -17,9 +17,9 @@ namespace hill {
 
 		template<typename VT> size_t add(VT val)
 		{
-			mem.resize(mem.size() + mem.size() % alignof(VT) + sizeof val);
-			size_t start_ix = mem.size() - sizeof val;
-			*((VT *)(mem.data() + start_ix)) = val;
+			size_t start_ix = align_up(mem.size(), alignof(VT));
+			mem.resize(start_ix + sizeof val);
+			memcpy(mem.data() + start_ix, &val, sizeof val);
 			return start_ix;
 		}
 
@@ -42,7 +42,9 @@ namespace hill {
 
 		template<typename VT> VT get(size_t ix) const
 		{
-			return *((VT *)(mem.data() + ix));
+			VT val;
+			memcpy(&val, mem.data() + ix, sizeof val);
+			return val;
 		}
 
 		void copy(size_t ix, uint8_t *dst, size_t size) const
@@ -64,10 +66,10 @@ namespace hill {
 			return ix;
 		}
 
-		size_t add(size_t size, size_t cnt)
+		size_t add(size_t size, size_t align, size_t cnt)
 		{
-			size_t start_ix = ix;
-			ix += ix%size + size*cnt;
+			size_t start_ix = align_up(ix, align);
+			ix = start_ix + size*cnt;
 			return start_ix;
 		}
 	};
@@ -96,7 +98,10 @@ namespace hill {
 			memcpy(this->val, (uint8_t *)&v, sizeof v);
 		}
 		val_ref(uint32_t v, basic_type bt): mt(mem_type::LITERAL), u32(v), type(bt) {}
-		val_ref(void *p, type ts): mt(mem_type::LITERAL), p(p), type(ts) {}
+		val_ref(void *p, type ts, bool pure=false): mt(mem_type::LITERAL), p(p), type(ts)
+		{
+			type.is_pure_func = pure;
+		}
 
 		mem_type mt;
 		union {
@@ -7,9 +7,48 @@
 #include <string>
 #include <sstream>
 #include <stdint.h>
+#include <string.h>
 
 namespace hill {
 
+	/**
+	 * Reads a value from memory that may not be aligned for it
+	 */
+	template<typename VT> inline VT load_value(const uint8_t *p)
+	{
+		VT val;
+		memcpy(&val, p, sizeof val);
+		return val;
+	}
+
+	/**
+	 * Writes a value to memory that may not be aligned for it
+	 */
+	template<typename VT> inline void store_value(uint8_t *p, VT val)
+	{
+		memcpy(p, &val, sizeof val);
+	}
+
+	/**
+	 * C++ type holding a value of a number type
+	 */
+	template<basic_type BT> struct num_value;
+	template<> struct num_value<basic_type::I> {typedef int64_t type;};
+	template<> struct num_value<basic_type::I8> {typedef int8_t type;};
+	template<> struct num_value<basic_type::I16> {typedef int16_t type;};
+	template<> struct num_value<basic_type::I32> {typedef int32_t type;};
+	template<> struct num_value<basic_type::I64> {typedef int64_t type;};
+	template<> struct num_value<basic_type::U> {typedef uint64_t type;};
+	template<> struct num_value<basic_type::U8> {typedef uint8_t type;};
+	template<> struct num_value<basic_type::U16> {typedef uint16_t type;};
+	template<> struct num_value<basic_type::U32> {typedef uint32_t type;};
+	template<> struct num_value<basic_type::U64> {typedef uint64_t type;};
+	template<> struct num_value<basic_type::F> {typedef double type;};
+	template<> struct num_value<basic_type::F32> {typedef float type;};
+	template<> struct num_value<basic_type::F64> {typedef double type;};
+
+	template<basic_type BT> using num_value_t = typename num_value<BT>::type;
+
 	inline static std::string get_double_str(double val)
 	{
 		std::stringstream ss;
@@ -25,35 +64,33 @@ namespace hill {
 	template<typename VT> inline static std::string dump_value(const uint8_t *p)
 	{
 		if constexpr (std::is_same_v<VT, double>) {
-			return get_double_str(*(double *)p);
+			return get_double_str(load_value<double>(p));
 		} else if constexpr (std::is_same_v<VT, float>) {
-			return get_double_str((double)*(float *)p);
+			return get_double_str((double)load_value<float>(p));
 		} else {
 			std::stringstream ss;
-			ss << *(VT *)p;
+			ss << +load_value<VT>(p); // Promoted, so 8 bit values print as numbers
 			return ss.str();
 		}
 	}
 
-	inline std::string value_to_str(std::vector<basic_type> types, const uint8_t *p)
+	inline std::string value_to_str(const type &t, const uint8_t *p)
 	{
-		if (types.empty()) return "";
+		const auto &desc = t.desc();
+		if (desc.types.empty()) return "";
 
 		std::ostringstream ss;
 
-		switch (types[0]) {
+		switch (desc.types[0]) {
 		case basic_type::FUNC:
 			ss << (void *)p; // TODO: Find a sensible way to represent function pointers
 			break;
 		case basic_type::TUPLE:
 			{
 				ss << "(";
-				std::vector<basic_type> itypes;
-				size_t ix;
-				for (ix = 1; ix<types.size()-1; ix+=itypes.size(), p+=type_size(itypes)) {
-					itypes = inner_type(types, ix);
-					if (ix>1) ss << ",";
-					ss << value_to_str(itypes, p);
+				for (size_t ix=0; ix<desc.elms.size(); ++ix) {
+					if (ix>0) ss << ",";
+					ss << value_to_str(type::from_id(desc.elms[ix].id), p + desc.elms[ix].mem_offset);
 				}
 				ss << ")";
 			}
@@ -61,11 +98,11 @@ namespace hill {
 		case basic_type::ARRAY:
 			{
 				ss << "[";
-				std::vector<basic_type> itypes = inner_type(types, 1);
-				size_t cnt = (size_t)types[1+itypes.size()];
-				for (size_t ix=0; ix<cnt; ++ix, p+=type_size(itypes)) {
+				auto elm = type::from_id(desc.array_elm);
+				auto elm_size = elm.mem_size();
+				for (size_t ix=0; ix<desc.array_cnt; ++ix, p+=elm_size) {
 					if (ix>0) ss << ",";
-					ss << value_to_str(itypes, p);
+					ss << value_to_str(elm, p);
 				}
 				ss << "]";
 			}
@@ -101,7 +138,7 @@ namespace hill {
 
 		std::string to_str()
 		{
-			return value_to_str(ts.types, data.data());
+			return value_to_str(ts, data.data());
 		}
 	};
 }